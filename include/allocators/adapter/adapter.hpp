@@ -5,41 +5,113 @@
 
 #pragma once
 
+#include <algorithm>
 #include <cstddef>
+#include <limits>
+#include <new>
+#include <type_traits>
 
 #include <allocators/common/trait.hpp>
-#include <allocators/provider/lock_free_page.hpp>
+#include <allocators/internal/util.hpp>
+#include <allocators/strategy/freelist.hpp>
 #include <allocators/strategy/lock_free_bump.hpp>
+#include <allocators/strategy/ring.hpp>
+#include <allocators/strategy/stack.hpp>
 
 namespace allocators::adapter {
 
-template <class T, class... Args>
-class BumpAdapter
-    : public strategy::LockFreeBump<provider::LockFreePage<>, Args...> {
+// Allocator that satisfies the standard's Allocator requirements by forwarding
+// to |Strategy|. The adapter is a handle to a strategy owned elsewhere: copies,
+// including rebound copies, share the same strategy, and two adapters compare
+// equal only if they do. The strategy must outlive every adapter, and every
+// container, that refers to it.
+//
+// Since containers may move or swap storage between each other, the adapter
+// is propagated on copy assignment, move assignment and swap.
+//
+// As required by the standard, |allocate| throws |std::bad_alloc| on failure.
+// |deallocate| returns memory, along with its layout, to the strategy if it
+// supports per-object returns, otherwise memory is reclaimed when the
+// strategy is reset.
+template <class T, class Strategy>
+requires StrategyTrait<Strategy>
+class Adapter {
 public:
   // Require alias for std::allocator_traits to infer other types, e.g.
   // using pointer = value_type*.
   using value_type = T;
 
-  using Parent = strategy::LockFreeBump<Args...>;
+  using propagate_on_container_copy_assignment = std::true_type;
+  using propagate_on_container_move_assignment = std::true_type;
+  using propagate_on_container_swap = std::true_type;
+  using is_always_equal = std::false_type;
 
-  T* allocate(std::size_t n) noexcept {
-    Result<std::byte*> ptr_or = Parent::Allocate(n);
+  template <class U> struct rebind {
+    using other = Adapter<U, Strategy>;
+  };
+
+  explicit Adapter(Strategy& strategy) noexcept : strategy_(&strategy) {}
+
+  template <class U>
+  Adapter(const Adapter<U, Strategy>& other) noexcept
+      : strategy_(other.GetStrategy()) {}
+
+  [[nodiscard]] T* allocate(std::size_t n) {
+    if (n > max_size())
+      throw std::bad_array_new_length();
+
+    Result<std::byte*> ptr_or =
+        strategy_->Find(Layout(n * sizeof(T), kAlignment));
     if (ptr_or.has_error())
-      return nullptr;
+      throw std::bad_alloc();
+
     return reinterpret_cast<T*>(ptr_or.value());
   }
 
-  void deallocate(T*, std::size_t) noexcept {}
+  void deallocate(T* p, std::size_t n) noexcept {
+    if (p == nullptr || !strategy_->AcceptsReturn())
+      return;
+
+    // TODO: Don't ignore this error.
+    (void)strategy_->Return(reinterpret_cast<std::byte*>(p),
+                            Layout(n * sizeof(T), kAlignment));
+  }
+
+  [[nodiscard]] constexpr std::size_t max_size() const noexcept {
+    return std::numeric_limits<std::size_t>::max() / sizeof(T);
+  }
+
+  [[nodiscard]] Strategy* GetStrategy() const noexcept { return strategy_; }
+
+private:
+  static constexpr std::size_t kAlignment =
+      std::max(alignof(T), internal::kMinimumAlignment);
+
+  Strategy* strategy_;
 };
 
-template <class T, class U>
-bool operator==(const BumpAdapter<T>&, const BumpAdapter<U>&) {
-  return true;
+template <class T, class U, class Strategy>
+bool operator==(const Adapter<T, Strategy>& lhs,
+                const Adapter<U, Strategy>& rhs) noexcept {
+  return lhs.GetStrategy() == rhs.GetStrategy();
 }
 
-template <class T, class U>
-bool operator!=(const BumpAdapter<T>&, const BumpAdapter<U>&) {
-  return false;
+template <class T, class U, class Strategy>
+bool operator!=(const Adapter<T, Strategy>& lhs,
+                const Adapter<U, Strategy>& rhs) noexcept {
+  return !(lhs == rhs);
 }
+
+template <class T, class Provider, class... Args>
+using BumpAdapter = Adapter<T, strategy::LockFreeBump<Provider, Args...>>;
+
+template <class T, class Provider, class... Args>
+using FreeListAdapter = Adapter<T, strategy::FreeList<Provider, Args...>>;
+
+template <class T, class Provider, class... Args>
+using RingAdapter = Adapter<T, strategy::Ring<Provider, Args...>>;
+
+template <class T, class Provider, class... Args>
+using StackAdapter = Adapter<T, strategy::Stack<Provider, Args...>>;
+
 } // namespace allocators::adapter
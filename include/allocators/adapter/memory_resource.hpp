@@ -0,0 +1,111 @@
+// Adapter class for |std::pmr::memory_resource|. The documentation for
+// |std::pmr::memory_resource| can be found at
+// https://en.cppreference.com/w/cpp/memory/memory_resource.
+
+#pragma once
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <memory_resource>
+#include <new>
+
+#include <allocators/common/trait.hpp>
+#include <allocators/internal/util.hpp>
+
+namespace allocators::adapter {
+
+// Memory resource that forwards to |Allocator|, which is either a strategy or
+// a provider. This lets |std::pmr| containers use the allocators in this
+// library without changing the container types.
+//
+// For strategies, |do_allocate| and |do_deallocate| map onto |Find| and the
+// sized |Return|. Memory is only returned to strategies that support
+// per-object returns, otherwise it's reclaimed when the strategy is reset.
+//
+// For providers, every allocation is rounded up to a whole number of blocks.
+// Providers only state the size of their blocks, not their alignment, so an
+// allocation fails if the block provided isn't aligned as requested, e.g. a
+// 64-byte alignment over |provider::Static|. Alignments larger than the block
+// size are never supported. Neither are allocations spanning more than one
+// block on providers that hand out a single block at a time, e.g.
+// |provider::LockFreePage|.
+//
+// Two resources are equal only if they are the same object. |Allocator| is
+// held by reference and must outlive this object. As required by the
+// standard, |do_allocate| throws |std::bad_alloc| on failure.
+template <class Allocator>
+requires StrategyTrait<Allocator> || ProviderTrait<Allocator>
+class MemoryResource : public std::pmr::memory_resource {
+public:
+  explicit MemoryResource(Allocator& allocator) : allocator_(allocator) {}
+
+  ALLOCATORS_NO_COPY_NO_MOVE_NO_DEFAULT(MemoryResource);
+
+  Allocator& GetAllocator() const { return allocator_.get(); }
+
+private:
+  void* do_allocate(std::size_t bytes, std::size_t alignment) override {
+    Result<std::byte*> ptr_or = Allocate(ToLayout(bytes, alignment));
+    if (ptr_or.has_error())
+      throw std::bad_alloc();
+
+    return ptr_or.value();
+  }
+
+  void do_deallocate(void* p, std::size_t bytes,
+                     std::size_t alignment) override {
+    auto* ptr = static_cast<std::byte*>(p);
+    if constexpr (StrategyTrait<Allocator>) {
+      if (!allocator_.get().AcceptsReturn())
+        return;
+
+      // TODO: Don't ignore this error.
+      (void)allocator_.get().Return(ptr, ToLayout(bytes, alignment));
+    } else {
+      // TODO: Don't ignore this error.
+      (void)allocator_.get().Return(ptr);
+    }
+  }
+
+  bool do_is_equal(const std::pmr::memory_resource& other) const
+      noexcept override {
+    return this == &other;
+  }
+
+  // Requests are clamped to what the allocators accept, identically on
+  // allocation and deallocation so that sized returns see the same layout.
+  static Layout ToLayout(std::size_t bytes, std::size_t alignment) {
+    return Layout(std::max(bytes, std::size_t(1)),
+                  std::max(alignment, internal::kMinimumAlignment));
+  }
+
+  Result<std::byte*> Allocate(Layout layout) {
+    if constexpr (StrategyTrait<Allocator>) {
+      return allocator_.get().Find(layout);
+    } else {
+      std::size_t block_size = allocator_.get().GetBlockSize();
+      if (layout.alignment > block_size)
+        return cpp::fail(Error::InvalidInput);
+
+      auto ptr_or = allocator_.get().Provide((layout.size + block_size - 1) /
+                                             block_size);
+      if (ptr_or.has_error())
+        return cpp::fail(ptr_or.error());
+
+      std::byte* ptr = ptr_or.value();
+      if (reinterpret_cast<std::uintptr_t>(ptr) % layout.alignment != 0) {
+        // TODO: Don't ignore this error.
+        (void)allocator_.get().Return(ptr);
+        return cpp::fail(Error::InvalidInput);
+      }
+
+      return ptr;
+    }
+  }
+
+  std::reference_wrapper<Allocator> allocator_;
+};
+
+} // namespace allocators::adapter
@@ -1,6 +1,7 @@
 #pragma once
 
 #include <cstddef>
+#include <span>
 
 #include <allocators/common/error.hpp>
 #include <allocators/internal/util.hpp>
@@ -44,12 +45,38 @@ concept StrategyTrait = requires(T strategy, const T const_strategy,
   { strategy.Find(layout) } -> std::same_as<Result<std::byte*>>;
   { strategy.Find(size) } -> std::same_as<Result<std::byte*>>;
   { strategy.Return(bytes) } -> std::same_as<Result<void>>;
+  { strategy.Return(bytes, layout) } -> std::same_as<Result<void>>;
   { strategy.Reset() } -> std::same_as<Result<void>>;
 
   { const_strategy.AcceptsAlignment() } -> std::same_as<bool>;
   { const_strategy.AcceptsReturn() } -> std::same_as<bool>;
 };
 
+// Strategies that can tell whether a pointer was handed out by them. This is
+// used by composite strategies to route |Return| calls to the right strategy.
+template <class T>
+concept OwnershipTrait = requires(const T const_strategy, std::byte* bytes) {
+  { const_strategy.Owns(bytes) } -> std::same_as<bool>;
+};
+
+// Strategies that can grow or shrink an allocation without moving it.
+// |Resize| fails, leaving the allocation untouched, when it can't be done in
+// place. Callers are then expected to fall back to |Find|, copy and |Return|.
+template <class T>
+concept ResizeTrait = requires(T strategy, std::byte* bytes, Layout layout) {
+  { strategy.Resize(bytes, layout) } -> std::same_as<Result<void>>;
+};
+
+// Strategies that can serve many allocations of the same layout, or take many
+// allocations back, in a single call. |FindBatch| fills every entry of its
+// output or fails without allocating anything.
+template <class T>
+concept BatchStrategyTrait =
+    requires(T strategy, Layout layout, std::span<std::byte*> bytes) {
+  { strategy.FindBatch(layout, bytes) } -> std::same_as<Result<void>>;
+  { strategy.ReturnBatch(bytes) } -> std::same_as<Result<void>>;
+};
+
 template <class T>
 concept ProviderTrait = requires(T provider, const T const_provider,
                                  std::size_t count, std::byte* bytes) {
@@ -58,4 +85,19 @@ concept ProviderTrait = requires(T provider, const T const_provider,
   { const_provider.GetBlockSize() } -> std::same_as<std::size_t>;
 };
 
+// Providers that can hand out, or take back, many single blocks in a single
+// call. |ProvideBatch| fills every entry of its output or fails without
+// providing anything.
+template <class T>
+concept BatchProviderTrait = requires(T provider, std::span<std::byte*> bytes) {
+  { provider.ProvideBatch(bytes) } -> std::same_as<Result<void>>;
+  { provider.ReturnBatch(bytes) } -> std::same_as<Result<void>>;
+};
+
+// Providers that only hand out zero-filled blocks, e.g. because every block
+// is freshly mapped from the OS. Strategies can then skip clearing bytes they
+// haven't written to since the block was provided.
+template <class T>
+concept ZeroedProviderTrait = ProviderTrait<T> && T::kProvidesZeroedBlocks;
+
 } // namespace allocators
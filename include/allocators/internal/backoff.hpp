@@ -0,0 +1,41 @@
+// The Backoff class, for retrying contended atomic operations.
+
+#pragma once
+
+#include <algorithm>
+#include <cstdint>
+
+namespace allocators::internal {
+
+// Hint to the processor that the caller is spinning, so that it can yield
+// resources to a sibling hyper-thread and save power.
+inline void Relax() {
+#if defined(__x86_64__) || defined(__i386__)
+  __builtin_ia32_pause();
+#elif defined(__aarch64__) || defined(__arm__)
+  asm volatile("yield");
+#endif
+}
+
+// A Backoff spaces out the retries of an atomic operation that failed due to
+// contention. Every call to |Pause| spins twice as long as the one before, up
+// to a cap, so that threads hammering the same location spread out instead of
+// invalidating each other's cache lines in lockstep.
+class Backoff {
+public:
+  Backoff() = default;
+
+  void Pause() {
+    for (std::uint32_t i = 0; i < spins_; ++i)
+      Relax();
+
+    spins_ = std::min(spins_ * 2, kMaxSpins);
+  }
+
+private:
+  static constexpr std::uint32_t kMaxSpins = 1 << 10;
+
+  std::uint32_t spins_ = 1;
+};
+
+} // namespace allocators::internal
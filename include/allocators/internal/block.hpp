@@ -4,15 +4,17 @@
 // usage by the user requesting the memory. A small portion is
 // reserved in the beginning of the block to contain necessary
 // metadata for tracking blocks. This metadata is encapsulated
-// in the BlockHeader class.
+// in the BlockHeader class, or in the CompactBlockHeader class
+// where header overhead matters more than block size.
 
 #pragma once
 
 #include <cassert>
+#include <concepts>
 #include <cstddef>
 #include <cstdint>
 #include <cstdlib>
-#include <functional>
+#include <limits>
 #include <optional>
 #include <strings.h>
 
@@ -46,16 +48,78 @@ struct BlockHeader {
     header->next = next;
     return header;
   }
+
+  std::size_t GetSize() const { return size; }
+
+  void SetSize(std::size_t new_size) { size = new_size; }
+
+  BlockHeader* GetNext() const { return next; }
+
+  void SetNext(BlockHeader* new_next) { next = new_next; }
+};
+
+// A CompactBlockHeader tracks the same metadata as |BlockHeader| in half the
+// space. Both fields are 32 bits wide and |next| is kept as an offset from
+// the header itself, so blocks in the same list must be less than 2GB away
+// from each other, which holds for blocks carved out of the same block
+// fetched from a provider.
+struct CompactBlockHeader {
+  // The size of the entire block, including this header.
+  std::uint32_t size = 0;
+
+  // Offset in bytes from this header to the next block in the list, or 0
+  // if this is the last block.
+  std::int32_t next = 0;
+
+  std::size_t GetSize() const { return size; }
+
+  void SetSize(std::size_t new_size) {
+    assert(new_size <= std::numeric_limits<std::uint32_t>::max());
+    size = static_cast<std::uint32_t>(new_size);
+  }
+
+  CompactBlockHeader* GetNext() const {
+    if (next == 0)
+      return nullptr;
+
+    auto address = reinterpret_cast<std::intptr_t>(this) + next;
+    return reinterpret_cast<CompactBlockHeader*>(address);
+  }
+
+  void SetNext(CompactBlockHeader* new_next) {
+    if (new_next == nullptr) {
+      next = 0;
+      return;
+    }
+
+    auto offset = reinterpret_cast<std::intptr_t>(new_next) -
+                  reinterpret_cast<std::intptr_t>(this);
+    assert(offset != 0 && offset >= std::numeric_limits<std::int32_t>::min() &&
+           offset <= std::numeric_limits<std::int32_t>::max());
+    next = static_cast<std::int32_t>(offset);
+  }
+};
+
+static_assert(sizeof(CompactBlockHeader) == 8);
+
+// A header layout that the functions below can operate on.
+template <class T>
+concept BlockHeaderTrait = requires(T header, const T const_header,
+                                    std::size_t size) {
+  { const_header.GetSize() } -> std::same_as<std::size_t>;
+  { header.SetSize(size) } -> std::same_as<void>;
+  { const_header.GetNext() } -> std::same_as<T*>;
+  { header.SetNext(&header) } -> std::same_as<void>;
 };
 
-// A pair of BlockHeader* where the |prev| is guaranteed to have its |next|
+// A pair of headers where the |prev| is guaranteed to have its |next|
 // field set to |header|.
-struct HeaderPair {
-  BlockHeader* prev = nullptr;
-  BlockHeader* header = nullptr;
+template <BlockHeaderTrait Header = BlockHeader> struct HeaderPair {
+  Header* prev = nullptr;
+  Header* header = nullptr;
 
-  explicit HeaderPair(BlockHeader* header, BlockHeader* prev = nullptr)
-      : header(header), prev(prev) {
+  explicit HeaderPair(Header* header, Header* prev = nullptr)
+      : prev(prev), header(header) {
     assert(header != nullptr);
   }
 };
@@ -70,54 +134,56 @@ template <class T> [[gnu::const]] inline constexpr std::uintptr_t AsUint(T* p) {
 }
 
 // Fixed size of Block header.
+template <BlockHeaderTrait Header = BlockHeader>
 inline constexpr std::size_t GetBlockHeaderSize() {
-  return sizeof(BlockHeader);
+  return sizeof(Header);
 }
 
 // Size of block when not accounting for header.
-inline std::size_t BlockSize(BlockHeader* header) {
+template <BlockHeaderTrait Header> inline std::size_t BlockSize(Header* header) {
   if (!header)
     return 0;
 
-  return header->size - GetBlockHeaderSize();
+  return header->GetSize() - GetBlockHeaderSize<Header>();
 }
 
 // Get pointer to block referenced by |header|.
-inline std::byte* GetBlock(BlockHeader* header) {
+template <BlockHeaderTrait Header> inline std::byte* GetBlock(Header* header) {
   assert(header != nullptr);
 
-  return AsBytePtr(header) + GetBlockHeaderSize();
+  return AsBytePtr(header) + GetBlockHeaderSize<Header>();
 }
 
 // Get header from block referenced by |ptr|.
-inline BlockHeader* GetHeader(std::byte* ptr) {
+template <BlockHeaderTrait Header = BlockHeader>
+inline Header* GetHeader(std::byte* ptr) {
   assert(ptr != nullptr);
 
-  return reinterpret_cast<BlockHeader*>(ptr - GetBlockHeaderSize());
+  return reinterpret_cast<Header*>(ptr - GetBlockHeaderSize<Header>());
 }
 
 // Zero out the contents of the block referenced by |header|.
-inline void ZeroBlock(BlockHeader* header) {
+template <BlockHeaderTrait Header> inline void ZeroBlock(Header* header) {
   if (!header)
     return;
 
-  std::byte* base = AsBytePtr(header) + GetBlockHeaderSize();
-  std::size_t size = header->size - GetBlockHeaderSize();
+  std::byte* base = AsBytePtr(header) + GetBlockHeaderSize<Header>();
+  std::size_t size = header->GetSize() - GetBlockHeaderSize<Header>();
   bzero(base, size);
 }
 
-// Cast |BlockHeader*| pointed by head to |VirtualAddressRange| objects and free
+// Cast |Header*| pointed by head to |VirtualAddressRange| objects and free
 // their associated memory using |release|.
-inline Failable<void>
-ReleaseBlockList(BlockHeader* head,
-                 std::function<Failable<void>(std::byte*)> release,
-                 BlockHeader* sentinel = nullptr) {
+template <BlockHeaderTrait Header, class Release>
+requires std::invocable<Release&, std::byte*>
+inline Failable<void> ReleaseBlockList(Header* head, Release release,
+                                       Header* sentinel = nullptr) {
   if (head == nullptr)
     return cpp::fail(Failure::HeaderIsNullptr);
 
-  BlockHeader* itr = head;
+  Header* itr = head;
   while (itr != sentinel) {
-    BlockHeader* next = itr->next;
+    Header* next = itr->GetNext();
     if (auto result = release(AsBytePtr(itr)); result.has_error())
       return cpp::fail(result.error());
 
@@ -128,17 +194,18 @@ ReleaseBlockList(BlockHeader* head,
 }
 
 // Return first header that has at least |minimum_size| bytes available.
-inline Failable<std::optional<HeaderPair>>
-FindBlockByFirstFit(BlockHeader* head, std::size_t minimum_size) {
+template <BlockHeaderTrait Header>
+inline Failable<std::optional<HeaderPair<Header>>>
+FindBlockByFirstFit(Header* head, std::size_t minimum_size) {
   if (head == nullptr)
     return cpp::fail(Failure::HeaderIsNullptr);
 
   if (minimum_size == 0)
     return cpp::fail(Failure::InvalidSize);
 
-  for (BlockHeader *itr = head, *prev = nullptr; itr != nullptr;
-       prev = itr, itr = itr->next)
-    if (itr->size >= minimum_size)
+  for (Header *itr = head, *prev = nullptr; itr != nullptr;
+       prev = itr, itr = itr->GetNext())
+    if (itr->GetSize() >= minimum_size)
       return HeaderPair(itr, prev);
 
   return std::nullopt;
@@ -146,61 +213,109 @@ FindBlockByFirstFit(BlockHeader* head, std::size_t minimum_size) {
 
 // Return header that most closely fits |minimum_size| using |cmp| as the
 // criteria.
-inline Failable<std::optional<HeaderPair>>
-FindBlockByFit(BlockHeader* head, std::size_t minimum_size,
-               std::function<bool(std::size_t, std::size_t)> cmp) {
+template <BlockHeaderTrait Header, class Compare>
+requires std::predicate<Compare&, std::size_t, std::size_t>
+inline Failable<std::optional<HeaderPair<Header>>>
+FindBlockByFit(Header* head, std::size_t minimum_size, Compare cmp) {
   if (head == nullptr)
     return cpp::fail(Failure::HeaderIsNullptr);
 
   if (minimum_size == 0)
     return cpp::fail(Failure::InvalidSize);
 
-  std::optional<HeaderPair> target = std::nullopt;
-  for (BlockHeader *itr = head, *prev = nullptr; itr != nullptr;
-       prev = itr, itr = itr->next) {
-    if (itr->size < minimum_size)
+  std::optional<HeaderPair<Header>> target = std::nullopt;
+  for (Header *itr = head, *prev = nullptr; itr != nullptr;
+       prev = itr, itr = itr->GetNext()) {
+    if (itr->GetSize() < minimum_size)
       continue;
 
-    if (!target.has_value() || cmp(itr->size, target->header->size)) {
+    if (!target.has_value() || cmp(itr->GetSize(), target->header->GetSize())) {
       target = HeaderPair(itr, prev);
     }
   }
   return target;
 }
 
-inline Failable<std::optional<HeaderPair>>
-FindBlockByBestFit(BlockHeader* head, std::size_t minimum_size) {
-  return FindBlockByFit(
-      head, minimum_size,
-      /*cmp=*/[](std::size_t a, std::size_t b) { return a < b; });
+// A policy that picks the block of a free list to serve a request of at least
+// |minimum_size| bytes. Policies that also define |Prefer(a, b)|, returning
+// whether a block of |a| bytes is a better fit than one of |b| bytes, can be
+// used to choose among candidates from several free lists. Otherwise, the
+// first candidate found is used.
+template <class T, class Header>
+concept FitPolicyTrait = BlockHeaderTrait<Header> &&
+                         requires(Header* head, std::size_t minimum_size) {
+  {
+    T::Find(head, minimum_size)
+    } -> std::same_as<Failable<std::optional<HeaderPair<Header>>>>;
+};
+
+// Use first block that contains at least the minimum size.
+struct FirstFit {
+  template <BlockHeaderTrait Header>
+  static Failable<std::optional<HeaderPair<Header>>>
+  Find(Header* head, std::size_t minimum_size) {
+    return FindBlockByFirstFit(head, minimum_size);
+  }
+};
+
+// Use the *smallest* block that contains at least the minimum size.
+struct BestFit {
+  static constexpr bool Prefer(std::size_t a, std::size_t b) { return a < b; }
+
+  template <BlockHeaderTrait Header>
+  static Failable<std::optional<HeaderPair<Header>>>
+  Find(Header* head, std::size_t minimum_size) {
+    return FindBlockByFit(
+        head, minimum_size,
+        /*cmp=*/[](std::size_t a, std::size_t b) { return Prefer(a, b); });
+  }
+};
+
+// Use the *largest* block that contains at least the minimum size.
+struct WorstFit {
+  static constexpr bool Prefer(std::size_t a, std::size_t b) { return a > b; }
+
+  template <BlockHeaderTrait Header>
+  static Failable<std::optional<HeaderPair<Header>>>
+  Find(Header* head, std::size_t minimum_size) {
+    return FindBlockByFit(
+        head, minimum_size,
+        /*cmp=*/[](std::size_t a, std::size_t b) { return Prefer(a, b); });
+  }
+};
+
+template <BlockHeaderTrait Header>
+inline Failable<std::optional<HeaderPair<Header>>>
+FindBlockByBestFit(Header* head, std::size_t minimum_size) {
+  return BestFit::Find(head, minimum_size);
 }
 
-inline Failable<std::optional<HeaderPair>>
-FindBlockByWorstFit(BlockHeader* head, std::size_t minimum_size) {
-  return FindBlockByFit(
-      head, minimum_size,
-      /*cmp=*/[](std::size_t a, std::size_t b) { return a > b; });
+template <BlockHeaderTrait Header>
+inline Failable<std::optional<HeaderPair<Header>>>
+FindBlockByWorstFit(Header* head, std::size_t minimum_size) {
+  return WorstFit::Find(head, minimum_size);
 }
 
-inline Failable<BlockHeader*> FindPriorBlock(BlockHeader* head,
-                                             BlockHeader* block) {
+template <BlockHeaderTrait Header>
+inline Failable<Header*> FindPriorBlock(Header* head, Header* block) {
   if (block == nullptr || head == nullptr)
     return cpp::fail(Failure::HeaderIsNullptr);
 
   if (AsUint(head) >= AsUint(block))
     return nullptr;
 
-  BlockHeader* itr = head;
-  while (itr->next && AsUint(itr->next) < AsUint(block))
-    itr = itr->next;
+  Header* itr = head;
+  while (itr->GetNext() && AsUint(itr->GetNext()) < AsUint(block))
+    itr = itr->GetNext();
 
   return itr;
 }
 
-// Split block and return new |BlockHeader*|.
-inline Failable<BlockHeader*> SplitBlock(BlockHeader* block,
-                                         std::size_t bytes_needed,
-                                         std::size_t alignment) {
+// Split block and return new |Header*|. The contents of the block are left
+// as is.
+template <BlockHeaderTrait Header>
+inline Failable<Header*> SplitBlock(Header* block, std::size_t bytes_needed,
+                                    std::size_t alignment) {
   if (!block)
     return cpp::fail(Failure::HeaderIsNullptr);
   if (!bytes_needed)
@@ -209,39 +324,71 @@ inline Failable<BlockHeader*> SplitBlock(BlockHeader* block,
     return cpp::fail(Failure::InvalidAlignment);
 
   std::size_t total_bytes_needed = AlignUp(bytes_needed, alignment);
-  std::size_t new_block_size = block->size - total_bytes_needed;
+  std::size_t new_block_size = block->GetSize() - total_bytes_needed;
 
   // Minimum size for a new block.
-  if (new_block_size < AlignUp(GetBlockHeaderSize() + 1, alignment))
+  if (new_block_size < AlignUp(GetBlockHeaderSize<Header>() + 1, alignment))
     return nullptr;
 
-  ZeroBlock(block);
   std::byte* new_block_addr = AsBytePtr(block) + total_bytes_needed;
-  auto* new_header = reinterpret_cast<BlockHeader*>(new_block_addr);
-  new_header->next = block->next;
-  new_header->size = new_block_size;
+  auto* new_header = reinterpret_cast<Header*>(new_block_addr);
+  new_header->SetNext(block->GetNext());
+  new_header->SetSize(new_block_size);
 
-  block->size = total_bytes_needed;
-  block->next = new_header;
+  block->SetSize(total_bytes_needed);
+  block->SetNext(new_header);
 
   return new_header;
 }
 
 // Coalesces free block so long as the |next| ptr is equivalent to the
-// succeeding block when using offset of |block|.
-inline Failable<void> CoalesceBlock(BlockHeader* block) {
+// succeeding block when using offset of |block|. Like |SplitBlock|, this
+// leaves the contents of the block as is.
+template <BlockHeaderTrait Header>
+inline Failable<void> CoalesceBlock(Header* block) {
   if (!block)
     return cpp::fail(Failure::HeaderIsNullptr);
 
-  while (AsBytePtr(block->next) == AsBytePtr(block) + block->size) {
-    BlockHeader* next = block->next;
-    block->size += next->size;
-    block->next = next->next;
+  while (AsBytePtr(block->GetNext()) == AsBytePtr(block) + block->GetSize()) {
+    Header* next = block->GetNext();
+    block->SetSize(block->GetSize() + next->GetSize());
+    block->SetNext(next->GetNext());
   }
 
-  ZeroBlock(block);
-
   return {};
 }
 
+// Sort the list of blocks starting at |head| by address, with a merge sort
+// that only relinks the blocks. Returns the new head of the list.
+template <BlockHeaderTrait Header>
+inline Header* SortBlocksByAddress(Header* head) {
+  if (head == nullptr || head->GetNext() == nullptr)
+    return head;
+
+  Header* middle = head;
+  for (Header* itr = head->GetNext(); itr && itr->GetNext();
+       itr = itr->GetNext()->GetNext())
+    middle = middle->GetNext();
+
+  Header* second = middle->GetNext();
+  middle->SetNext(nullptr);
+  Header* a = SortBlocksByAddress(head);
+  Header* b = SortBlocksByAddress(second);
+
+  Header* sorted = nullptr;
+  Header* tail = nullptr;
+  while (a != nullptr || b != nullptr) {
+    Header*& lowest = b == nullptr || (a && AsUint(a) < AsUint(b)) ? a : b;
+    Header* block = lowest;
+    lowest = lowest->GetNext();
+    if (tail)
+      tail->SetNext(block);
+    else
+      sorted = block;
+    tail = block;
+  }
+
+  return sorted;
+}
+
 } // namespace allocators::internal
@@ -57,35 +57,49 @@ public:
     auto index = index_or.value();
     auto value = table[index];
     header.occupied.reset(index);
+
+    // Shift later entries of the same probe run back into the hole, so that
+    // |Locate| can stop at the first empty slot.
+    std::size_t hole = index;
+    for (std::size_t probeIndex = (index + 1) % GetCapacity();
+         header.occupied[probeIndex];
+         probeIndex = (probeIndex + 1) % GetCapacity()) {
+      std::size_t home = GetHomeIndex(table[probeIndex].address);
+      bool reachable = hole <= probeIndex
+                           ? (hole < home && home <= probeIndex)
+                           : (hole < home || home <= probeIndex);
+      if (reachable)
+        continue;
+
+      table[hole] = table[probeIndex];
+      header.occupied.set(hole);
+      header.occupied.reset(probeIndex);
+      hole = probeIndex;
+    }
+
     return value;
   }
 
   void SetNext(std::byte* next) { header.next = next; }
 
 private:
-  std::optional<std::size_t> Locate(std::uint64_t address) const {
+  std::size_t GetHomeIndex(std::uint64_t address) const {
     std::hash<std::uint64_t> hasher;
-    std::size_t hash = hasher(address);
-    std::size_t startIndex = hash % GetCapacity();
+    return hasher(address) % GetCapacity();
+  }
+
+  std::optional<std::size_t> Locate(std::uint64_t address) const {
+    std::size_t startIndex = GetHomeIndex(address);
     std::size_t probeIndex = startIndex;
 
+    // Entries are kept in unbroken runs starting from their home index, see
+    // |Take|, so the probe stops at the first empty slot.
     do {
-      if (header.occupied[probeIndex]) {
-        if (table[probeIndex].address == address)
-          return probeIndex;
-
-        // The stopping condition for this probe is not when it
-        // encounters the first empty slot. Rather, it's when ti
-        // encounters a table entry with a different address. The
-        // reason for this is that for the pathological case where
-        // all entries have same entries, we can get false negatives
-        // after removing the first entry. This will happen because the
-        // probe algorithm will see an empty slot and return std::nullopt,
-        // even though all subsequent slots are taken with equivalent
-        // entries.
-        if (table[probeIndex].address != address)
-          return std::nullopt;
-      }
+      if (!header.occupied[probeIndex])
+        return std::nullopt;
+
+      if (table[probeIndex].address == address)
+        return probeIndex;
 
       probeIndex = (probeIndex + 1) % GetCapacity();
     } while (probeIndex != startIndex);
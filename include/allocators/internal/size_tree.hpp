@@ -0,0 +1,156 @@
+// The SizeTree class, an index of free blocks ordered by size.
+
+#pragma once
+
+#include <cassert>
+#include <cstddef>
+#include <cstdint>
+#include <utility>
+
+#include <allocators/internal/block.hpp>
+#include <allocators/internal/util.hpp>
+
+namespace allocators::internal {
+
+// A SizeTree keeps free blocks ordered by size, for best-fit and worst-fit
+// lookups in O(log n) expected time. Like treebins in dlmalloc, the tree
+// takes no memory of its own: its nodes live in the blocks themselves, right
+// after their header, so only blocks of at least |kMinimumBlockSize| bytes
+// can be added. Every node carries |Data|, supplied by the owner of the tree.
+//
+// The tree is a treap keyed by size, then address, so that blocks of the same
+// size are kept in address order. Priorities are derived from addresses,
+// which spread well enough without any random state to seed.
+template <BlockHeaderTrait Header, class Data> class SizeTree {
+public:
+  struct Node {
+    Node* left = nullptr;
+    Node* right = nullptr;
+    Data data;
+  };
+
+  static constexpr std::size_t kMinimumBlockSize =
+      GetBlockHeaderSize<Header>() + sizeof(Node);
+
+  SizeTree() = default;
+
+  ALLOCATORS_NO_COPY_NO_MOVE(SizeTree);
+
+  bool IsEmpty() const { return root_ == nullptr; }
+
+  // Add free |block|, which must not be in the tree already.
+  void Insert(Header* block, Data data) {
+    assert(block->GetSize() >= kMinimumBlockSize);
+
+    Node* node = GetNode(block);
+    node->left = nullptr;
+    node->right = nullptr;
+    node->data = std::move(data);
+
+    Node* left = nullptr;
+    Node* right = nullptr;
+    Split(root_, GetKey(block), left, right);
+    root_ = Merge(Merge(left, node), right);
+  }
+
+  // Remove |block|, which must be in the tree. Its size must not have
+  // changed since it was added.
+  void Erase(Header* block) {
+    Key key = GetKey(block);
+    Node** link = &root_;
+    while (*link != nullptr && *link != GetNode(block))
+      link = key < GetKey(*link) ? &(*link)->left : &(*link)->right;
+
+    assert(*link != nullptr);
+    *link = Merge((*link)->left, (*link)->right);
+  }
+
+  // Remove every block at once.
+  void Clear() { root_ = nullptr; }
+
+  // Smallest block of at least |size| bytes, lowest in memory among equals.
+  Header* LowerBound(std::size_t size) const {
+    Key key = {size, 0};
+    Node* bound = nullptr;
+    for (Node* itr = root_; itr != nullptr;) {
+      if (GetKey(itr) < key) {
+        itr = itr->right;
+      } else {
+        bound = itr;
+        itr = itr->left;
+      }
+    }
+
+    return bound ? GetHeader(bound) : nullptr;
+  }
+
+  // Largest block, highest in memory among equals.
+  Header* Max() const {
+    Node* itr = root_;
+    while (itr != nullptr && itr->right != nullptr)
+      itr = itr->right;
+
+    return itr ? GetHeader(itr) : nullptr;
+  }
+
+  // |Data| of |block|, which must be in the tree.
+  static Data& GetData(Header* block) { return GetNode(block)->data; }
+
+private:
+  using Key = std::pair<std::size_t, std::uintptr_t>;
+
+  static Node* GetNode(Header* block) {
+    return reinterpret_cast<Node*>(AsBytePtr(block) +
+                                   GetBlockHeaderSize<Header>());
+  }
+
+  static Header* GetHeader(Node* node) {
+    return reinterpret_cast<Header*>(AsBytePtr(node) -
+                                     GetBlockHeaderSize<Header>());
+  }
+
+  static Key GetKey(Header* block) { return {block->GetSize(), AsUint(block)}; }
+
+  static Key GetKey(Node* node) { return GetKey(GetHeader(node)); }
+
+  // Priority of |node| in the heap order of the treap, a hash of its
+  // address.
+  static std::uint64_t GetPriority(Node* node) {
+    return (AsUint(node) >> 3) * 0x9E3779B97F4A7C15ull;
+  }
+
+  // Split |root| into |left|, the nodes ordered before |key|, and |right|,
+  // the rest.
+  static void Split(Node* root, Key key, Node*& left, Node*& right) {
+    if (root == nullptr) {
+      left = right = nullptr;
+    } else if (GetKey(root) < key) {
+      Split(root->right, key, root->right, right);
+      left = root;
+    } else {
+      Split(root->left, key, left, root->left);
+      right = root;
+    }
+  }
+
+  // Join |left| and |right|, where every node of |left| is ordered before
+  // every node of |right|.
+  static Node* Merge(Node* left, Node* right) {
+    if (left == nullptr)
+      return right;
+    if (right == nullptr)
+      return left;
+
+    if (GetPriority(left) > GetPriority(right)) {
+      left->right = Merge(left->right, right);
+      return left;
+    }
+
+    right->left = Merge(left, right->left);
+    return right;
+  }
+
+  Node* root_ = nullptr;
+};
+
+} // namespace allocators::internal
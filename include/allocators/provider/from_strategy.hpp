@@ -0,0 +1,90 @@
+#pragma once
+
+#include <algorithm>
+#include <cstddef>
+#include <functional>
+#include <limits>
+
+#include <template/parameters.hpp>
+
+#include <allocators/common/error.hpp>
+#include <allocators/common/trait.hpp>
+#include <allocators/internal/platform.hpp>
+#include <allocators/internal/util.hpp>
+
+namespace allocators::provider {
+
+// Parameters for FromStrategy class defined below.
+struct FromStrategyParams {
+  // Size of the blocks provided. Defaults to the platform's page size.
+  template <std::size_t Size>
+  struct SizeT : std::integral_constant<std::size_t, Size> {};
+
+  // Alignment of the blocks provided. Defaults to |alignof(max_align_t)|.
+  // Must be a power of two and greater than |sizeof(void*)|.
+  template <std::size_t Alignment>
+  struct AlignmentT : std::integral_constant<std::size_t, Alignment> {};
+};
+
+// Provider class that fetches its blocks from a strategy instead of the
+// operating system. This allows for hierarchical allocators, e.g. a
+// |LockFreeBump| over memory managed by a |FreeList|, or a |FreeList| running
+// inside of an arena. Blocks requested from this provider are carved out of
+// |Strategy|, so no system calls are made once |Strategy| has enough memory.
+//
+// If |Strategy| doesn't support per-object returns, e.g. |LockFreeBump|,
+// |Return| fails with |Error::OperationNotSupported|, and blocks are only
+// reclaimed once |Strategy| is reset. A strategy nested over this provider
+// therefore can't release its blocks early, e.g. through |FreeList::Trim|.
+//
+// |Strategy| is held by reference and must outlive this object. This provider
+// is as thread-safe as |Strategy| is.
+template <class Strategy, class... Args>
+requires StrategyTrait<Strategy>
+class FromStrategy : public FromStrategyParams {
+public:
+  static constexpr std::size_t kBlockSize =
+      ntp::optional<SizeT<internal::GetPageSize()>, Args...>::value;
+
+  static constexpr std::size_t kAlignment = std::max(
+      {internal::kMinimumAlignment,
+       ntp::optional<AlignmentT<alignof(std::max_align_t)>, Args...>::value});
+
+  explicit FromStrategy(Strategy& strategy) : strategy_(strategy) {}
+
+  ALLOCATORS_NO_COPY_NO_MOVE_NO_DEFAULT(FromStrategy);
+
+  Result<std::byte*> Provide(std::size_t count) {
+    if (count == 0 || count > kMaxCount)
+      return cpp::fail(Error::InvalidInput);
+
+    return strategy_.get().Find(Layout(count * kBlockSize, kAlignment));
+  }
+
+  Result<void> Return(std::byte* bytes) {
+    if (bytes == nullptr)
+      return cpp::fail(Error::InvalidInput);
+
+    if (!strategy_.get().AcceptsReturn())
+      return cpp::fail(Error::OperationNotSupported);
+
+    return strategy_.get().Return(bytes);
+  }
+
+  [[nodiscard]] static constexpr std::size_t GetBlockSize() {
+    return kBlockSize;
+  }
+
+private:
+  // Upper bound on |count| so that |count * kBlockSize| doesn't overflow.
+  static constexpr std::size_t kMaxCount =
+      std::numeric_limits<std::size_t>::max() / kBlockSize;
+
+  static_assert(kBlockSize > 0, "kBlockSize must be greater than 0.");
+  static_assert(internal::IsPowerOfTwo(kAlignment),
+                "kAlignment must be a power of 2.");
+
+  std::reference_wrapper<Strategy> strategy_;
+};
+
+} // namespace allocators::provider
@@ -1,14 +1,17 @@
 #pragma once
 
+#include <algorithm>
+#include <array>
 #include <atomic>
 #include <cstdint>
-#include <optional>
-#include <thread>
+#include <new>
+#include <span>
 
 #include <template/parameters.hpp>
 
 #include <allocators/common/error.hpp>
 #include <allocators/common/trait.hpp>
+#include <allocators/internal/backoff.hpp>
 #include <allocators/internal/platform.hpp>
 #include <allocators/internal/util.hpp>
 
@@ -16,20 +19,42 @@ namespace allocators::provider {
 
 // Parameters for LockFreePage class defined below.
 struct LockFreePageParams {
-  static constexpr std::uint64_t kDefaultLimit = (1 << 18) - 1;
+  // Max number of pages in a super block. This is bound by the width of the
+  // fields in an anchor, see |LockFreePage::Anchor|.
+  static constexpr std::uint64_t kMaxSuperBlockPages = (1 << 18) - 1;
+
+  static constexpr std::uint64_t kDefaultLimit = 64 * kMaxSuperBlockPages;
 
   // Max number of pages that Provider will create. This is a strict limit.
-  // No more than this number of pages will be supported.
-  // Defaults to |kDefaultLimit| / |internal, which is roughly: 1GB /
-  // GetPageSize().
+  // No more than this number of pages will be supported. Pages are reserved
+  // one super block at a time, as they are needed, so a high limit costs
+  // nothing up front. Defaults to |kDefaultLimit|, which is roughly:
+  // 64GB / GetPageSize().
   template <std::uint64_t R>
   struct LimitT : std::integral_constant<std::uint64_t, R> {};
+
+  // Number of pages reserved at once whenever the provider runs out of pages.
+  // Defaults to |kMaxSuperBlockPages|, or to |LimitT| if that's lower.
+  template <std::uint64_t R>
+  struct SuperBlockT : std::integral_constant<std::uint64_t, R> {};
 };
 
 // Provider class that returns page-aligned and page-sized blocks. The page size
 // is determined by the platform, 4KB for most scenarios. For the actual page
 // size used on particular platform, see |internal::GetPageSize|. This provider
 // is thread-safe using lock-free algorithms.
+//
+// Pages are carved out of super blocks, large ranges of pages reserved at
+// once. The provider starts out with no super block, and attaches a new one
+// whenever those it has can't fulfill a request, until |LimitT| is reached.
+// Every super block keeps its own free list of pages, so that super blocks
+// can be added without disturbing the ones in use.
+//
+// Under contention, failed updates of a free list are retried with
+// exponential backoff. Meanwhile, threads providing and returning a single
+// page meet in an elimination array, where a returned page is handed over
+// directly without going through a free list at all. See "A Scalable
+// Lock-free Stack Algorithm" by Hendler et al.
 template <class... Args> class LockFreePage : public LockFreePageParams {
 public:
   LockFreePage() = default;
@@ -45,60 +70,83 @@ public:
     if (count != 1)
       return cpp::fail(Error::OperationNotSupported);
 
+    std::byte* ptr = nullptr;
+    if (auto result = ProvideBatch(std::span(&ptr, 1)); result.has_error())
+      return cpp::fail(result.error());
+
+    return ptr;
+  }
+
+  Result<void> Return(std::byte* p) {
+    return ReturnBatch(std::span(&p, 1));
+  }
+
+  // Fill |out| with pages, popping all of them off the free list of a single
+  // super block in a single atomic update. Either every entry is filled or
+  // none are. So, |out| can't hold more than |SuperBlockT| pages.
+  Result<void> ProvideBatch(std::span<std::byte*> out) {
+    if (out.size() > kSuperBlockPages)
+      return cpp::fail(Error::InvalidInput);
+
+    if (out.empty())
+      return {};
+
     while (true) {
-      auto old_anchor = anchor_.load();
-      if (old_anchor.status == Status::Initial) {
-        if (auto result = InitializeHeap(); result.has_error())
-          return cpp::fail(result.error());
+      // Super blocks attached so far are searched even while another one is
+      // being attached, so that pages returned to them are handed out without
+      // waiting for the attachment.
+      auto extent = extent_.load();
+
+      // Start with the super block that served the last request, the most
+      // likely one to have pages left.
+      std::size_t hint = hint_.load(std::memory_order_relaxed);
+      for (std::size_t i = 0; i < extent.count; ++i) {
+        std::size_t index = (hint + i) % extent.count;
+        if (PopPages(*super_blocks_[index], out)) {
+          if (index != hint)
+            hint_.store(index, std::memory_order_relaxed);
+
+          return {};
+        }
+      }
 
-        continue;
-      } else if (old_anchor.status == Status::Allocating) {
-        std::this_thread::yield();
+      if (extent.status == Status::Allocating) {
+        extent_.wait(extent);
         continue;
       }
 
-      if (old_anchor.available == 0 || old_anchor.head == kLimit)
-        return cpp::fail(Error::NoFreeBlock);
-
-      auto new_anchor = old_anchor;
-      new_anchor.available = old_anchor.available - 1;
-      new_anchor.head = GetHeap()->descriptors[old_anchor.head].next;
-      if (anchor_.compare_exchange_weak(old_anchor, new_anchor)) {
-        auto& descriptor = GetHeap()->descriptors[old_anchor.head];
-        descriptor.occupied = true;
-        descriptor.next = 0;
-        auto ptr =
-            reinterpret_cast<std::byte*>(GetHeap()->super_block.address) +
-            old_anchor.head * internal::GetPageSize();
-        return reinterpret_cast<std::byte*>(ptr);
-      }
+      if (auto result = AttachSuperBlock(extent); result.has_error())
+        return cpp::fail(result.error());
     }
   }
 
-  Result<void> Return(std::byte* p) {
-    if (p == nullptr || heap_ == std::nullopt)
-      return cpp::fail(Error::InvalidInput);
-
-    auto distance =
-        reinterpret_cast<std::uintptr_t>(p) - GetHeap()->super_block.address;
+  // Push every page in |pages| back onto the free list of its super block.
+  // Each run of pages from the same super block is pushed in a single atomic
+  // update. Fails with |Error::InvalidInput|, without returning any page, if
+  // one of them wasn't provided by this provider or was already returned.
+  Result<void> ReturnBatch(std::span<std::byte*> pages) {
+    if (pages.empty())
+      return {};
 
-    std::size_t index = distance / internal::GetPageSize();
-    GetHeap()->descriptors[index].occupied = false;
+    // Catch pages that weren't provided, or that were already returned.
+    for (std::byte* ptr : pages) {
+      SuperBlock* super_block = FindSuperBlock(ptr);
+      if (super_block == nullptr ||
+          !IsOccupied(*super_block, GetIndex(*super_block, ptr)))
+        return cpp::fail(Error::InvalidInput);
+    }
 
-    while (true) {
-      auto old_anchor = anchor_.load();
-      auto new_anchor = old_anchor;
-      new_anchor.head = index;
-      new_anchor.available = old_anchor.available + 1;
+    for (std::size_t first = 0; first < pages.size();) {
+      SuperBlock* super_block = FindSuperBlock(pages[first]);
+      std::size_t last = first + 1;
+      while (last < pages.size() && Contains(*super_block, pages[last]))
+        ++last;
 
-      // Eagerly set head here so that if another thread immediately takes
-      // this block after the CAS instruction below, the Descriptor entry
-      // is in a valid state.
-      GetHeap()->descriptors[index].next = old_anchor.head;
-      if (anchor_.compare_exchange_weak(old_anchor, new_anchor)) {
-        return {};
-      }
+      PushPages(*super_block, pages.subspan(first, last - first));
+      first = last;
     }
+
+    return {};
   }
 
   [[nodiscard]] static constexpr std::size_t GetBlockSize() {
@@ -107,91 +155,322 @@ public:
 
 private:
   static constexpr std::uint64_t kLimit =
-      std::max({kDefaultLimit, ntp::optional<LimitT<0>, Args...>::value});
+      ntp::optional<LimitT<kDefaultLimit>, Args...>::value;
+
+  static_assert(kLimit > 0, "LimitT must be greater than 0");
+
+  static constexpr std::uint64_t kSuperBlockPages = std::min(
+      kLimit, ntp::optional<SuperBlockT<kMaxSuperBlockPages>, Args...>::value);
+
+  static_assert(kSuperBlockPages > 0 &&
+                    kSuperBlockPages <= kMaxSuperBlockPages,
+                "SuperBlockT must be in [1, kMaxSuperBlockPages]");
+
+  static constexpr std::size_t kMaxSuperBlocks =
+      (kLimit + kSuperBlockPages - 1) / kSuperBlockPages;
+
+  // Super blocks are found by a linear search on return, and their table is
+  // kept inline.
+  static_assert(kMaxSuperBlocks <= 1024,
+                "LimitT / SuperBlockT must not exceed 1024");
+
+  static constexpr std::size_t kEliminationSlots = 16;
 
-  // A block descriptor is an entry in the linked list of blocks.
-  struct Descriptor {
-    // Index of next entry in list.
-    std::size_t next;
+  // Number of times a returning thread checks whether its offer was taken.
+  static constexpr std::size_t kOfferSpins = 128;
 
-    // Whether this block is currently in use.
-    bool occupied;
+  // Index marking the end of the free list of a super block.
+  static constexpr std::uint64_t kEnd = kSuperBlockPages;
+
+  static constexpr std::size_t kBitsPerWord = 64;
+
+  static constexpr std::size_t kBitmapWords =
+      (kSuperBlockPages + kBitsPerWord - 1) / kBitsPerWord;
+
+  /*
+   * Anchor is a bitfield of 64 bits. The bits are outlined below from low bit
+   * to high bits.
+   *  head: 18 = Index of current head of LIFO list.
+   *  available: 18 = Number of pages available for allocation.
+   *    0 if at capacity.
+   *  tag: 28 = Incremented on every pop, so that a list that was popped and
+   *    pushed back to the same head, i.e. the ABA problem, isn't mistaken
+   *    for an unchanged one.
+   */
+  struct Anchor {
+    std::uint64_t head : 18;
+    std::uint64_t available : 18;
+    std::uint64_t tag : 28;
   };
 
-  struct alignas(internal::GetPageSize()) Heap {
-    internal::VirtualAddressRange super_block;
-    Descriptor descriptors[kLimit];
+  // A range of |count| pages starting at |base|, along with the free list
+  // threaded through them. Pages are described by two tables rather than one
+  // of structs, so that links take 4 bytes a page and occupancy a single bit,
+  // with no padding in between.
+  struct alignas(internal::GetPageSize()) SuperBlock {
+    std::byte* base;
+    std::size_t count;
+    std::atomic<Anchor> anchor;
+
+    // Bit i is set while page i is in use.
+    std::atomic<std::uint64_t> occupied[kBitmapWords];
+
+    // Index of the page following page i in the free list.
+    std::uint32_t next[kSuperBlockPages];
   };
 
   enum Status : std::uint64_t {
     Initial = 0,
     Allocating = 1,
     Allocated = 2,
-    Failed = 3
   };
 
   /*
-   * Anchor is a bitfield of 64 bits. The bits are outlined below from low bit
-   * to high bits.
-   *  status: 2 = Status to see if heap has been initialized:
+   * Extent is a bitfield of 64 bits, tracking the super blocks attached so
+   * far.
+   *  status: 2 = Whether a super block is being attached:
    *    Initial, Allocating, Allocated
-   *  head: 18 = Index of current head of LIFO list.
-   *  available: 18 = Number of pages available for allocation.
-   *    0 if at capacity.
+   *  count: 62 = Number of entries of |super_blocks_| in use.
    */
-  struct Anchor {
+  struct Extent {
     std::uint64_t status : 2;
-    std::uint64_t head : 18;
-    std::uint64_t available : 18;
-    std::uint64_t reserved : 26;
+    std::uint64_t count : 62;
   };
 
-  Result<void> InitializeHeap() {
-    auto old_anchor = anchor_.load();
-    if (old_anchor.status != Status::Initial)
-      return {};
+  // Take |out.size()| pages off the free list of |super_block|. Returns false
+  // if it doesn't have that many pages left.
+  bool PopPages(SuperBlock& super_block, std::span<std::byte*> out) {
+    internal::Backoff backoff;
+    for (std::size_t attempt = 0;; ++attempt) {
+      auto old_anchor = super_block.anchor.load();
+      if (old_anchor.available < out.size() || old_anchor.head == kEnd)
+        return false;
+
+      // The walk below may read links concurrently rewritten by other
+      // threads. That's harmless, as the tag makes the CAS fail in that case.
+      std::uint64_t head = old_anchor.head;
+      std::size_t count = 0;
+      for (; count < out.size() && head < kEnd; ++count) {
+        out[count] = GetBlock(super_block, head);
+        head = super_block.next[head];
+      }
+
+      auto new_anchor = old_anchor;
+      new_anchor.available = old_anchor.available - out.size();
+      new_anchor.head = head;
+      new_anchor.tag = old_anchor.tag + 1;
+      if (count == out.size() &&
+          super_block.anchor.compare_exchange_weak(old_anchor, new_anchor)) {
+        for (std::byte* ptr : out)
+          SetOccupied(super_block, GetIndex(super_block, ptr), true);
+
+        return true;
+      }
+
+      if (out.size() == 1 && TakeOffer(attempt, out.front()))
+        return true;
+
+      backoff.Pause();
+    }
+  }
+
+  // Push |pages|, all of which belong to |super_block|, back onto its free
+  // list.
+  void PushPages(SuperBlock& super_block, std::span<std::byte*> pages) {
+    // Chain the pages together ahead of time, so that splicing them in only
+    // takes linking the last one to the current head.
+    for (std::size_t i = 0; i < pages.size(); ++i) {
+      std::size_t index = GetIndex(super_block, pages[i]);
+      SetOccupied(super_block, index, false);
+      if (i + 1 < pages.size())
+        super_block.next[index] = GetIndex(super_block, pages[i + 1]);
+    }
+
+    std::size_t first = GetIndex(super_block, pages.front());
+    std::size_t last = GetIndex(super_block, pages.back());
+    internal::Backoff backoff;
+    for (std::size_t attempt = 0;; ++attempt) {
+      auto old_anchor = super_block.anchor.load();
+      auto new_anchor = old_anchor;
+      new_anchor.head = first;
+      new_anchor.available = old_anchor.available + pages.size();
+
+      // Eagerly set head here so that if another thread immediately takes
+      // this block after the CAS instruction below, its link is in a valid
+      // state.
+      super_block.next[last] = old_anchor.head;
+      if (super_block.anchor.compare_exchange_weak(old_anchor, new_anchor))
+        return;
+
+      if (pages.size() == 1 && Offer(attempt, pages.front()))
+        return;
+
+      backoff.Pause();
+    }
+  }
 
-    auto new_anchor = old_anchor;
-    new_anchor.status = Status::Allocating;
-    if (!anchor_.compare_exchange_weak(old_anchor, new_anchor))
+  // Take a page offered by a thread returning one, from the slot of the
+  // elimination array picked for |attempt|. Returns false if there was none.
+  bool TakeOffer(std::size_t attempt, std::byte*& page) {
+    auto& slot = elimination_[GetSlot(attempt)].page;
+    std::byte* offer = slot.load();
+    if (offer == nullptr || !slot.compare_exchange_strong(offer, nullptr))
+      return false;
+
+    // The page was marked free when it was returned.
+    SuperBlock* super_block = FindSuperBlock(offer);
+    SetOccupied(*super_block, GetIndex(*super_block, offer), true);
+    page = offer;
+    return true;
+  }
+
+  // Offer |page| in the slot of the elimination array picked for |attempt|,
+  // and wait a little for a thread to take it. Returns false if none did, in
+  // which case the page is withdrawn.
+  bool Offer(std::size_t attempt, std::byte* page) {
+    auto& slot = elimination_[GetSlot(attempt)].page;
+    std::byte* empty = nullptr;
+    if (!slot.compare_exchange_strong(empty, page))
+      return false;
+
+    for (std::size_t i = 0; i < kOfferSpins; ++i) {
+      if (slot.load() != page)
+        return true;
+
+      internal::Relax();
+    }
+
+    // The page may have been taken, then returned and offered in this very
+    // slot again. Withdrawing it is still correct: whichever thread succeeds
+    // pushes it to the free list, while the other sees it as taken.
+    return !slot.compare_exchange_strong(page, nullptr);
+  }
+
+  // Slot of the elimination array for the calling thread, on its |attempt|-th
+  // retry. Slots are picked from the address of the thread's stack, spread
+  // with a Fibonacci hash, so that threads start out on different slots.
+  static std::size_t GetSlot(std::size_t attempt) {
+    std::uint64_t stack = reinterpret_cast<std::uintptr_t>(&attempt) /
+                          internal::GetPageSize();
+    std::uint64_t hash = (stack * 0x9E3779B97F4A7C15ull) >> 32;
+    return (hash + attempt) % kEliminationSlots;
+  }
+
+  // Reserve and attach a new super block, unless another thread already did
+  // since |extent| was loaded.
+  Result<void> AttachSuperBlock(Extent extent) {
+    if (extent.count == kMaxSuperBlocks)
+      return cpp::fail(Error::NoFreeBlock);
+
+    auto new_extent = extent;
+    new_extent.status = Status::Allocating;
+    if (!extent_.compare_exchange_strong(extent, new_extent))
       return {};
 
-    auto heap_va_range_or =
-        internal::FetchPages(sizeof(Heap) / internal::GetPageSize());
+    auto super_block_or = CreateSuperBlock(extent.count);
+    if (super_block_or.has_error()) {
+      extent_.store(extent);
+      extent_.notify_all();
+      return cpp::fail(super_block_or.error());
+    }
+
+    super_blocks_[extent.count] = super_block_or.value();
+    hint_.store(extent.count, std::memory_order_relaxed);
+
+    new_extent.status = Status::Allocated;
+    new_extent.count = extent.count + 1;
+    extent_.store(new_extent);
+    extent_.notify_all();
+    return {};
+  }
+
+  // Map the super block at |index| of |super_blocks_|, with all of its pages
+  // free.
+  static Result<SuperBlock*> CreateSuperBlock(std::size_t index) {
+    std::size_t count =
+        std::min(kSuperBlockPages, kLimit - index * kSuperBlockPages);
+
+    auto metadata_or =
+        internal::FetchPages(sizeof(SuperBlock) / internal::GetPageSize());
     // TODO: Mapping of internal to user-facing error should be more robust.
-    if (heap_va_range_or.has_error())
+    if (metadata_or.has_error())
       return cpp::fail(Error::OutOfMemory);
 
-    auto sb_va_range_or = internal::FetchPages(kLimit);
-    if (sb_va_range_or.has_error())
+    auto pages_or = internal::FetchPages(count);
+    if (pages_or.has_error()) {
+      (void)internal::ReturnPages(metadata_or.value());
       return cpp::fail(Error::OutOfMemory);
-
-    auto heap_va_range = heap_va_range_or.value();
-    Heap* heap = reinterpret_cast<Heap*>(heap_va_range.address);
-    heap->super_block = sb_va_range_or.value();
-    for (auto i = 0u; i < kLimit; ++i) {
-      Descriptor& descriptor = heap->descriptors[i];
-      descriptor.occupied = false;
-      descriptor.next = i + 1;
     }
 
-    heap_ = heap_va_range;
+    // Freshly mapped pages are zeroed, so every page starts out free.
+    auto* super_block =
+        new (reinterpret_cast<void*>(metadata_or.value().address)) SuperBlock;
+    super_block->base = reinterpret_cast<std::byte*>(pages_or.value().address);
+    super_block->count = count;
+    for (auto i = 0u; i < count; ++i)
+      super_block->next[i] = i + 1 < count ? i + 1 : kEnd;
+
+    Anchor anchor = {};
+    anchor.available = count;
+    super_block->anchor.store(anchor);
+    return super_block;
+  }
 
-    new_anchor.available = kLimit;
-    new_anchor.status = Status::Allocated;
-    anchor_.store(new_anchor);
-    return {};
+  // Super block that |ptr| belongs to, or nullptr if none.
+  SuperBlock* FindSuperBlock(std::byte* ptr) {
+    auto extent = extent_.load();
+    for (std::size_t i = 0; i < extent.count; ++i)
+      if (Contains(*super_blocks_[i], ptr))
+        return super_blocks_[i];
+
+    return nullptr;
+  }
+
+  static bool Contains(const SuperBlock& super_block, std::byte* ptr) {
+    return ptr >= super_block.base &&
+           ptr < super_block.base + super_block.count * internal::GetPageSize();
   }
 
-  Heap* GetHeap() {
-    if (!heap_.has_value())
-      return nullptr;
+  static std::byte* GetBlock(const SuperBlock& super_block, std::size_t index) {
+    return super_block.base + index * internal::GetPageSize();
+  }
 
-    return reinterpret_cast<Heap*>(heap_->address);
+  static std::size_t GetIndex(const SuperBlock& super_block, std::byte* ptr) {
+    return (ptr - super_block.base) / internal::GetPageSize();
   }
 
-  std::atomic<Anchor> anchor_ = {};
-  std::optional<internal::VirtualAddressRange> heap_ = std::nullopt;
+  static bool IsOccupied(const SuperBlock& super_block, std::size_t index) {
+    std::uint64_t word = super_block.occupied[index / kBitsPerWord].load(
+        std::memory_order_relaxed);
+    return word & (std::uint64_t(1) << (index % kBitsPerWord));
+  }
+
+  // Neighboring pages share a word of the bitmap, so bits are flipped
+  // atomically even though a page only has one owner at a time.
+  static void SetOccupied(SuperBlock& super_block, std::size_t index,
+                          bool occupied) {
+    std::uint64_t bit = std::uint64_t(1) << (index % kBitsPerWord);
+    auto& word = super_block.occupied[index / kBitsPerWord];
+    if (occupied)
+      word.fetch_or(bit, std::memory_order_relaxed);
+    else
+      word.fetch_and(~bit, std::memory_order_relaxed);
+  }
+
+  std::atomic<Extent> extent_ = {};
+
+  // A slot in the elimination array, on a cache line of its own.
+  struct alignas(64) EliminationSlot {
+    std::atomic<std::byte*> page = nullptr;
+  };
+
+  std::array<EliminationSlot, kEliminationSlots> elimination_ = {};
+
+  // Index in |super_blocks_| where to start looking for free pages.
+  std::atomic<std::size_t> hint_ = 0;
+
+  // Super blocks attached so far, the first |Extent::count| of which are set.
+  std::array<SuperBlock*, kMaxSuperBlocks> super_blocks_ = {};
 };
 
 } // namespace allocators::provider
@@ -1,8 +1,11 @@
 #pragma once
 
+#include <cstddef>
+
 #include <template/parameters.hpp>
 
 #include <allocators/common/error.hpp>
+#include <allocators/internal/util.hpp>
 
 namespace allocators::provider {
 
@@ -38,7 +41,7 @@ public:
 private:
   std::byte* AsPtr() { return &block_[0]; }
 
-  std::byte block_[Size] = {std::byte(0)};
+  alignas(std::max_align_t) std::byte block_[Size] = {std::byte(0)};
 };
 
 } // namespace allocators::provider
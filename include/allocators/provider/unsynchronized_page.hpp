@@ -1,6 +1,11 @@
 #pragma once
 
+#include <algorithm>
+#include <array>
 #include <cstdint>
+#include <span>
+
+#include <template/parameters.hpp>
 
 #include <allocators/common/error.hpp>
 #include <allocators/internal/block_map.hpp>
@@ -8,14 +13,58 @@
 
 namespace allocators::provider {
 
+// Parameters for UnsynchronizedPage class defined below.
+struct UnsynchronizedPageParams {
+  // Number of pages mapped at once. Requests of up to that many pages are
+  // carved out of the current chunk, rather than mapped on their own. Larger
+  // requests are always mapped on their own. Defaults to 0, which maps every
+  // request on its own.
+  template <std::size_t Pages>
+  struct ChunkT : std::integral_constant<std::size_t, Pages> {};
+
+  // Max number of pages kept in a cache of returned ranges, instead of being
+  // unmapped. A request is served from a cached range of the same number of
+  // pages before anything new is mapped. Only ranges of up to
+  // |kMaxCachedRangePages| pages are cached. Defaults to 0, which disables
+  // the cache.
+  //
+  // Cached ranges are handed out again as they were left, so the provider
+  // doesn't guarantee zero-filled blocks when the cache is enabled.
+  template <std::size_t Pages>
+  struct CacheT : std::integral_constant<std::size_t, Pages> {};
+
+  static constexpr std::size_t kMaxCachedRangePages = 64;
+};
+
 // Provider class that returns page-aligned and page-sized blocks. The page size
 // is determined by the platform, 4KB for most scenarios. For the actual page
 // size used on particular platform, see |internal::GetPageSize|. This provider
 // is not thread-safe.
-template <class... Args> class UnsynchronizedPage {
+//
+// By default, every request maps pages of its own, which are unmapped when
+// returned. With |ChunkT| and |CacheT|, a service that keeps requesting and
+// returning ranges of similar sizes reaches a state where it makes no
+// system call at all.
+template <class... Args>
+class UnsynchronizedPage : public UnsynchronizedPageParams {
 public:
   UnsynchronizedPage() = default;
-  ~UnsynchronizedPage() = default;
+  // Unmap the cached ranges and the unused part of the current chunk. Pages
+  // that were provided and never returned are left as they are.
+  ~UnsynchronizedPage() {
+    for (std::size_t i = 0; i < kCacheBins; ++i) {
+      for (CachedRange* range = cache_[i]; range != nullptr;) {
+        CachedRange* next = range->next;
+        // TODO: Don't ignore error
+        (void)internal::ReturnPages(
+            MakeRange(reinterpret_cast<std::byte*>(range), i + 1));
+        range = next;
+      }
+    }
+
+    if (chunk_pages_ > 0)
+      (void)internal::ReturnPages(MakeRange(chunk_, chunk_pages_));
+  }
 
   ALLOCATORS_NO_COPY_NO_MOVE(UnsynchronizedPage);
 
@@ -32,9 +81,9 @@ public:
         return cpp::fail(result.error());
     }
 
-    auto va_range_or = internal::FetchPages(count);
+    auto va_range_or = FetchRange(count);
     if (va_range_or.has_error()) [[unlikely]]
-      return cpp::fail(Error::Internal);
+      return cpp::fail(va_range_or.error());
 
     auto va_range = va_range_or.value();
     head_->Insert(va_range);
@@ -52,9 +101,7 @@ public:
     BlockMap* itr = head_;
     while (itr != nullptr) {
       if (auto value_or = itr->Take(address); value_or.has_value()) {
-        (void)internal::ReturnPages(
-            value_or.value()); // TODO: Don't ignore error
-
+        ReleaseRange(value_or.value());
         return {};
       }
 
@@ -64,13 +111,119 @@ public:
     return cpp::fail(Error::InvalidInput);
   }
 
+  // Fill |out| with single pages. Either every entry is filled or none are.
+  Result<void> ProvideBatch(std::span<std::byte*> out) {
+    for (std::size_t i = 0; i < out.size(); ++i) {
+      auto p_or = Provide(1);
+      if (p_or.has_error()) {
+        // TODO: Don't ignore this error.
+        (void)ReturnBatch(out.first(i));
+        return cpp::fail(p_or.error());
+      }
+
+      out[i] = p_or.value();
+    }
+
+    return {};
+  }
+
+  Result<void> ReturnBatch(std::span<std::byte*> pages) {
+    for (std::byte* p : pages)
+      if (auto result = Return(p); result.has_error())
+        return cpp::fail(result.error());
+
+    return {};
+  }
+
   static constexpr std::size_t GetBlockSize() {
     return internal::GetPageSize();
   }
 
+  // Every block is mapped on demand, so it's always zero-filled, unless it
+  // comes out of the cache.
+  static constexpr bool kProvidesZeroedBlocks =
+      ntp::optional<CacheT<0>, Args...>::value == 0;
+
 private:
+  static constexpr std::size_t kChunkPages =
+      ntp::optional<ChunkT<0>, Args...>::value;
+
+  static constexpr std::size_t kCachePages =
+      ntp::optional<CacheT<0>, Args...>::value;
+
+  static_assert(kChunkPages <= internal::VirtualAddressRange::kMaxPageCount,
+                "ChunkT must fit in a VirtualAddressRange");
+
+  static constexpr std::size_t kCacheBins =
+      kCachePages == 0 ? 0 : kMaxCachedRangePages;
+
   using BlockMap = internal::BlockMap<GetBlockSize()>;
 
+  // A cached range. Cached ranges of the same number of pages are linked
+  // through their first bytes.
+  struct CachedRange {
+    CachedRange* next;
+  };
+
+  // Get a range of |count| pages, from the cache, the current chunk, or a
+  // mapping of its own, in that order.
+  Result<internal::VirtualAddressRange> FetchRange(std::size_t count) {
+    if (count <= kCacheBins && cache_[count - 1] != nullptr) {
+      CachedRange* range = cache_[count - 1];
+      cache_[count - 1] = range->next;
+      cached_pages_ -= count;
+      return MakeRange(reinterpret_cast<std::byte*>(range), count);
+    }
+
+    if (count <= kChunkPages) {
+      if (chunk_pages_ < count) {
+        auto chunk_or = internal::FetchPages(kChunkPages);
+        if (chunk_or.has_error()) [[unlikely]]
+          return cpp::fail(Error::Internal);
+
+        if (chunk_pages_ > 0)
+          ReleaseRange(MakeRange(chunk_, chunk_pages_));
+
+        chunk_ = internal::ToBytePtr(chunk_or.value().address);
+        chunk_pages_ = kChunkPages;
+      }
+
+      std::byte* ptr = chunk_;
+      chunk_ += count * internal::GetPageSize();
+      chunk_pages_ -= count;
+      return MakeRange(ptr, count);
+    }
+
+    auto va_range_or = internal::FetchPages(count);
+    if (va_range_or.has_error()) [[unlikely]]
+      return cpp::fail(Error::Internal);
+
+    return va_range_or.value();
+  }
+
+  // Put |va_range| in the cache if there's room for it, otherwise unmap it.
+  // Ranges carved out of a chunk are unmapped on their own, leaving the rest
+  // of the chunk mapped.
+  void ReleaseRange(internal::VirtualAddressRange va_range) {
+    std::size_t count = va_range.count;
+    if (count <= kCacheBins && cached_pages_ + count <= kCachePages) {
+      auto* range =
+          reinterpret_cast<CachedRange*>(internal::ToBytePtr(va_range.address));
+      range->next = cache_[count - 1];
+      cache_[count - 1] = range;
+      cached_pages_ += count;
+      return;
+    }
+
+    (void)internal::ReturnPages(va_range); // TODO: Don't ignore error
+  }
+
+  static internal::VirtualAddressRange MakeRange(std::byte* ptr,
+                                                 std::size_t count) {
+    return internal::VirtualAddressRange{
+        .address = internal::FromBytePtr<std::uint64_t>(ptr), .count = count};
+  }
+
   bool OutOfSpace() const { return head_ == nullptr || head_->IsFull(); }
 
   Result<void> FetchNewBlockMap() {
@@ -90,6 +243,14 @@ private:
   }
 
   BlockMap* head_ = nullptr;
+
+  // Unused part of the current chunk, |chunk_pages_| pages from |chunk_|.
+  std::byte* chunk_ = nullptr;
+  std::size_t chunk_pages_ = 0;
+
+  // Cached ranges of i + 1 pages, at index i.
+  std::array<CachedRange*, kCacheBins> cache_ = {};
+  std::size_t cached_pages_ = 0;
 };
 
 } // namespace allocators::provider
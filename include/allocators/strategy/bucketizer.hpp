@@ -0,0 +1,113 @@
+#pragma once
+
+#include <array>
+#include <concepts>
+#include <cstddef>
+#include <utility>
+
+#include <allocators/common/error.hpp>
+#include <allocators/common/trait.hpp>
+#include <allocators/internal/util.hpp>
+
+namespace allocators::strategy {
+
+// A composite strategy that fans requests out to several instances of
+// |Strategy| by size. The range of sizes (|Min|, |Max|] is split into buckets
+// of |Step| bytes each, and every bucket is served by its own instance. For
+// example, |Bucketizer<S, 0, 64, 16>| serves requests of 1-16 bytes from one
+// instance of |S|, 17-32 bytes from another, and so on. Requests outside of
+// the range fail. |Strategy| must be able to tell whether it owns a pointer
+// so that |Return|, without a layout, is routed to the right bucket.
+//
+// The instances are owned by this object, and are all constructed with the
+// same arguments, e.g. a shared provider. Unlike the composites that hold
+// their strategies by reference, |Reset| resets every instance.
+//
+// This strategy is as thread-safe as |Strategy| is.
+template <class Strategy, std::size_t Min, std::size_t Max, std::size_t Step>
+requires StrategyTrait<Strategy> && OwnershipTrait<Strategy>
+class Bucketizer {
+public:
+  static constexpr std::size_t kBucketCount = (Max - Min) / Step;
+
+  template <class... CtorArgs>
+  requires std::constructible_from<Strategy, CtorArgs&...>
+  explicit Bucketizer(CtorArgs&... args)
+      : buckets_(MakeBuckets(std::make_index_sequence<kBucketCount>(),
+                             args...)) {}
+
+  ALLOCATORS_NO_COPY_NO_MOVE_NO_DEFAULT(Bucketizer);
+
+  Result<std::byte*> Find(Layout layout) noexcept {
+    if (layout.size <= Min)
+      return cpp::fail(Error::InvalidInput);
+
+    if (layout.size > Max)
+      return cpp::fail(Error::SizeRequestTooLarge);
+
+    return buckets_[(layout.size - Min - 1) / Step].Find(layout);
+  }
+
+  Result<std::byte*> Find(std::size_t size) noexcept {
+    return Find(Layout(size, internal::kMinimumAlignment));
+  }
+
+  Result<void> Return(std::byte* ptr) {
+    for (auto& bucket : buckets_)
+      if (bucket.Owns(ptr))
+        return bucket.Return(ptr);
+
+    return cpp::fail(Error::InvalidInput);
+  }
+
+  // Route by the size of |layout|, the same way |Find| does, without asking
+  // every bucket whether it owns |ptr|.
+  Result<void> Return(std::byte* ptr, Layout layout) {
+    if (layout.size <= Min || layout.size > Max)
+      return cpp::fail(Error::InvalidInput);
+
+    return buckets_[(layout.size - Min - 1) / Step].Return(ptr, layout);
+  }
+
+  Result<void> Reset() {
+    for (auto& bucket : buckets_)
+      if (auto result = bucket.Reset(); result.has_error())
+        return cpp::fail(result.error());
+
+    return {};
+  }
+
+  bool Owns(std::byte* ptr) const {
+    for (const auto& bucket : buckets_)
+      if (bucket.Owns(ptr))
+        return true;
+
+    return false;
+  }
+
+  constexpr bool AcceptsAlignment() const {
+    return buckets_.front().AcceptsAlignment();
+  }
+
+  constexpr bool AcceptsReturn() const {
+    return buckets_.front().AcceptsReturn();
+  }
+
+private:
+  static_assert(Step > 0, "Step must be greater than 0.");
+  static_assert(Max > Min, "Max must be greater than Min.");
+  static_assert((Max - Min) % Step == 0,
+                "Range (Min, Max] must be a multiple of Step.");
+
+  // Strategies are neither copyable nor movable, so every bucket is
+  // constructed in place.
+  template <std::size_t... Is, class... CtorArgs>
+  static std::array<Strategy, kBucketCount>
+  MakeBuckets(std::index_sequence<Is...>, CtorArgs&... args) {
+    return {(static_cast<void>(Is), Strategy(args...))...};
+  }
+
+  std::array<Strategy, kBucketCount> buckets_;
+};
+
+} // namespace allocators::strategy
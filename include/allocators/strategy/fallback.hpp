@@ -0,0 +1,87 @@
+#pragma once
+
+#include <cstddef>
+#include <functional>
+
+#include <allocators/common/error.hpp>
+#include <allocators/common/trait.hpp>
+#include <allocators/internal/util.hpp>
+
+namespace allocators::strategy {
+
+// A composite strategy that serves requests from |Primary| and, if |Primary|
+// runs out of space, retries them on |Secondary|. Any other error from
+// |Primary|, e.g. |Error::InvalidInput|, is surfaced as is. |Primary| must be
+// able to tell whether it owns a pointer so that |Return| is routed to the
+// right strategy.
+//
+// Both strategies are held by reference and must outlive this object. Their
+// lifetime is up to their owner, so |Reset| doesn't reset them. Routing is
+// resolved at compile-time, so no virtual dispatch is involved.
+//
+// This strategy is as thread-safe as |Primary| and |Secondary| are.
+template <class Primary, class Secondary>
+requires StrategyTrait<Primary> && StrategyTrait<Secondary> &&
+         OwnershipTrait<Primary>
+class Fallback {
+public:
+  Fallback(Primary& primary, Secondary& secondary)
+      : primary_(primary), secondary_(secondary) {}
+
+  ALLOCATORS_NO_COPY_NO_MOVE_NO_DEFAULT(Fallback);
+
+  Result<std::byte*> Find(Layout layout) noexcept {
+    auto result = primary_.get().Find(layout);
+    if (result.has_value() || !IsOutOfSpace(result.error()))
+      return result;
+
+    return secondary_.get().Find(layout);
+  }
+
+  Result<std::byte*> Find(std::size_t size) noexcept {
+    return Find(Layout(size, internal::kMinimumAlignment));
+  }
+
+  Result<void> Return(std::byte* ptr) {
+    if (primary_.get().Owns(ptr))
+      return primary_.get().Return(ptr);
+
+    return secondary_.get().Return(ptr);
+  }
+
+  Result<void> Return(std::byte* ptr, Layout layout) {
+    if (primary_.get().Owns(ptr))
+      return primary_.get().Return(ptr, layout);
+
+    return secondary_.get().Return(ptr, layout);
+  }
+
+  // This object holds no state of its own, so there's nothing to reset.
+  Result<void> Reset() { return {}; }
+
+  bool Owns(std::byte* ptr) const requires OwnershipTrait<Secondary> {
+    return primary_.get().Owns(ptr) || secondary_.get().Owns(ptr);
+  }
+
+  constexpr bool AcceptsAlignment() const {
+    return primary_.get().AcceptsAlignment() &&
+           secondary_.get().AcceptsAlignment();
+  }
+
+  constexpr bool AcceptsReturn() const {
+    return primary_.get().AcceptsReturn() && secondary_.get().AcceptsReturn();
+  }
+
+private:
+  // Errors that signal |Primary| couldn't fit the request, as opposed to the
+  // request itself being malformed.
+  static constexpr bool IsOutOfSpace(Error error) {
+    return error == Error::NoFreeBlock || error == Error::ReachedMemoryLimit ||
+           error == Error::SizeRequestTooLarge;
+  }
+
+  std::reference_wrapper<Primary> primary_;
+  std::reference_wrapper<Secondary> secondary_;
+};
+
+} // namespace allocators::strategy
@@ -1,21 +1,33 @@
 #pragma once
 
+#include <algorithm>
+#include <array>
+#include <cassert>
 #include <cstddef>
+#include <cstdint>
+#include <cstring>
 #include <functional>
+#include <limits>
+#include <optional>
+#include <span>
+#include <type_traits>
+#include <variant>
 
 #include <template/optional.hpp>
 
 #include <allocators/common/error.hpp>
 #include <allocators/common/trait.hpp>
 #include <allocators/internal/block.hpp>
+#include <allocators/internal/size_tree.hpp>
 #include <allocators/internal/util.hpp>
 
 namespace allocators::strategy {
 
 struct FreeListParams {
-  // Alignment used when making an allocation. Usually, allocators defer to the
-  // alignment of the underlying object they are allocating. The constrains for
-  // this value are that it is a power of two and greater than |sizeof(void*)|.
+  // Minimum alignment of every allocation. A |Layout| asking for more is
+  // honored as well, by splitting the padding in front of the allocation off
+  // as a free block of its own. The constrains for this value are that it is a
+  // power of two and greater than |sizeof(void*)|.
   template <std::size_t Alignment>
   struct AlignmentT : std::integral_constant<std::size_t, Alignment> {};
 
@@ -28,14 +40,144 @@ struct FreeListParams {
     BestFit = 1,
     //
     // Use the *largest* block that contains the minimum sizes of bytes.
-    WorstFit = 2
+    WorstFit = 2,
+
+    // Use the first block that contains the minimum sizes of bytes, starting
+    // from where the previous search left off rather than from the head of
+    // the free list.
+    NextFit = 3
+  };
+
+  // Policy to employ when looking for a free block: one of |FindBy|, or an
+  // object of a custom policy type satisfying |internal::FitPolicyTrait|,
+  // e.g. |SearchT<MyFit{}>|.
+  template <auto Search>
+  struct SearchT : std::integral_constant<decltype(Search), Search> {};
+
+  // Where the size of an allocation is kept, so that it can be returned.
+  enum SizeTracking {
+    // Every allocation is preceded by a header recording its size.
+    InHeader = 0,
+
+    // Allocations carry no header. Callers must return every allocation with
+    // the layout it was found with, through |Return(ptr, layout)|, like sized
+    // |operator delete| does. |Resize| isn't supported in this mode.
+    ByCaller = 1
+  };
+
+  template <SizeTracking ST>
+  struct SizeTrackingT : std::integral_constant<SizeTracking, ST> {};
+
+  // Layout of the header placed in front of every block, free or allocated.
+  enum HeaderLayout {
+    // |internal::BlockHeader|, a full size and pointer: 16 bytes on 64-bit
+    // platforms.
+    Standard = 0,
+
+    // |internal::CompactBlockHeader|, a 32-bit size and a 32-bit offset to
+    // the next block: 8 bytes. Blocks from |Provider| must be under 2GB.
+    Compact = 1
+  };
+
+  template <HeaderLayout HL>
+  struct HeaderT : std::integral_constant<HeaderLayout, HL> {};
+
+  // When the contents of allocations are cleared.
+  enum Zeroing {
+    // Never. Allocations hold whatever was last written to their bytes.
+    Never = 0,
+
+    // On |Find|, like |calloc| does. Bytes known to be zero already, such as
+    // those of a fresh block from a |ZeroedProviderTrait| provider, aren't
+    // cleared again.
+    OnFind = 1,
+
+    // On |Return|, so that freed contents don't linger in memory.
+    OnReturn = 2
+  };
+
+  template <Zeroing Z> struct ZeroingT : std::integral_constant<Zeroing, Z> {};
+
+  // Free blocks of at least this many bytes are also indexed by size, in a
+  // tree threaded through the free blocks themselves, so that
+  // |FindBy::BestFit| and |FindBy::WorstFit| find them in O(log n) time
+  // rather than by scanning every free block. Smaller requests still scan.
+  // 0 disables the index.
+  template <std::size_t Threshold>
+  struct IndexThresholdT : std::integral_constant<std::size_t, Threshold> {};
+
+  // Returned blocks of up to this many bytes, headers included, skip the free
+  // list and go to a LIFO bin holding blocks of that exact size, without being
+  // coalesced. Requests for the same size pop from the bin in O(1) time. Bins
+  // are flushed to the free list once a search comes up empty, or once one
+  // holds more than |FastBinDepthT| blocks. 0 disables fast bins.
+  template <std::size_t MaxSize>
+  struct FastBinsT : std::integral_constant<std::size_t, MaxSize> {};
+
+  template <std::size_t Depth>
+  struct FastBinDepthT : std::integral_constant<std::size_t, Depth> {};
+
+  // When returned blocks are coalesced with their free neighbors.
+  enum Coalescing {
+    // On |Return|, which walks the free list to the block's place in it.
+    Eager = 0,
+
+    // In a single sort-and-merge pass, once a search comes up empty or on
+    // |Compact|. |Return| only pushes the block onto an unsorted list, in
+    // O(1) time. Every block fetched from |Provider| spends another pointer
+    // on its descriptor for that list.
+    Deferred = 1
+  };
+
+  template <Coalescing C>
+  struct CoalescingT : std::integral_constant<Coalescing, C> {};
+
+  // Number of blocks without any allocations held onto, rather than released
+  // back to the provider as soon as their last allocation is returned. Some
+  // slack keeps a workload that oscillates around a block boundary from
+  // fetching and releasing a block on every cycle. By default, every block is
+  // held onto until |Trim| or |Reset|.
+  template <std::size_t Count>
+  struct RetainedBlocksT : std::integral_constant<std::size_t, Count> {};
+
+  // What |Reset| does with the blocks fetched from the provider.
+  enum ResetMode {
+    // Release them back to the provider.
+    ReleaseBlocks = 0,
+
+    // Hold onto them, each turned back into a single free span.
+    KeepBlocks = 1
   };
 
-  template <FindBy FB> struct SearchT : std::integral_constant<FindBy, FB> {};
+protected:
+  // Fit policy used for |SearchT<Search>|.
+  template <auto Search> static constexpr auto GetFitPolicy() {
+    if constexpr (!std::is_same_v<decltype(Search), FindBy>)
+      return Search;
+    else if constexpr (Search == FindBy::FirstFit ||
+                       Search == FindBy::NextFit)
+      return internal::FirstFit();
+    else if constexpr (Search == FindBy::BestFit)
+      return internal::BestFit();
+    else
+      return internal::WorstFit();
+  }
+
+  // Whether |SearchT<Search>| is |By|.
+  template <auto Search, FindBy By> static constexpr bool IsSearch() {
+    if constexpr (std::is_same_v<decltype(Search), FindBy>)
+      return Search == By;
+
+    return false;
+  }
 };
 
 // Freelist allocator with tunable parameters. For reference as
-// to how to configure, see "common/parameters.hpp".
+// to how to configure, see "common/parameters.hpp". Memory is fetched from
+// |Provider| one block at a time, as needed. Blocks are held onto until
+// |Reset| or |Trim|, except for empty blocks past those retained per
+// |RetainedBlocksT|.
+// Every block keeps an address-ordered list of its own free space.
 template <class Provider, class... Args>
 requires ProviderTrait<Provider>
 class FreeList : public FreeListParams {
@@ -43,185 +185,1157 @@ public:
   static constexpr std::size_t kAlignment =
       std::max({sizeof(void*), ntp::optional<AlignmentT<0>, Args...>::value});
 
-  static constexpr FindBy kSearchStrategy =
+  static constexpr auto kSearchStrategy =
       ntp::optional<SearchT<FindBy::BestFit>, Args...>::value;
 
-  FreeList(Provider& provider) : provider_(provider) {}
+  static constexpr SizeTracking kSizeTracking =
+      ntp::optional<SizeTrackingT<SizeTracking::InHeader>, Args...>::value;
 
-  ALLOCATORS_NO_COPY_NO_MOVE_NO_DEFAULT(FreeList);
+  static constexpr HeaderLayout kHeaderLayout =
+      ntp::optional<HeaderT<HeaderLayout::Standard>, Args...>::value;
 
-  Result<std::byte*> Find(Layout layout) noexcept {
-    if (!IsValid(layout))
-      return cpp::fail(Error::InvalidInput);
+  static constexpr Zeroing kZeroing =
+      ntp::optional<ZeroingT<Zeroing::Never>, Args...>::value;
 
-    std::size_t request_size = internal::AlignUp(
-        layout.size + internal::GetBlockHeaderSize(), layout.alignment);
+  static constexpr std::size_t kIndexThreshold =
+      ntp::optional<IndexThresholdT<512>, Args...>::value;
 
-    if (request_size > GetAlignedSize())
-      return cpp::fail(Error::SizeRequestTooLarge);
+  static constexpr std::size_t kFastBinsMaxSize =
+      ntp::optional<FastBinsT<0>, Args...>::value;
 
-    if (auto init = InitBlockIfUnset(); init.has_error())
-      return cpp::fail(init.error());
+  static constexpr std::size_t kFastBinDepth =
+      ntp::optional<FastBinDepthT<64>, Args...>::value;
 
-    internal::Failable<std::optional<internal::HeaderPair>> first_fit_or_error =
-        GetFindBlockFn()(free_list_, request_size);
-    if (first_fit_or_error.has_error())
-      return cpp::fail(Error::Internal);
+  static constexpr Coalescing kCoalescing =
+      ntp::optional<CoalescingT<Coalescing::Eager>, Args...>::value;
 
-    std::optional<internal::HeaderPair> first_fit_or =
-        first_fit_or_error.value();
-    if (!first_fit_or.has_value())
-      return cpp::fail(Error::NoFreeBlock);
+  static constexpr std::size_t kRetainedBlocks = ntp::optional<
+      RetainedBlocksT<std::numeric_limits<std::size_t>::max()>,
+      Args...>::value;
 
-    auto first_fit = first_fit_or.value();
-    auto new_header_or =
-        internal::SplitBlock(first_fit.header, request_size, layout.alignment);
+  FreeList(Provider& provider) : provider_(provider) {}
 
-    // TODO: This should never occur. Also, if it is in fact possible,
-    // we should log the error before dropping it on the ground.
-    if (new_header_or.has_error())
-      return cpp::fail(Error::Internal);
+  ALLOCATORS_NO_COPY_NO_MOVE_NO_DEFAULT(FreeList);
 
-    auto new_header = new_header_or.value();
-    if (first_fit.header == free_list_)
-      free_list_ = new_header;
-    else if (first_fit.prev)
-      first_fit.prev->next = new_header;
+  // TODO: Don't ignore this error.
+  ~FreeList() { (void)Reset(); }
 
-    first_fit.header->next = nullptr;
-    return internal::AsBytePtr(first_fit.header) +
-           internal::GetBlockHeaderSize();
+  Result<std::byte*> Find(Layout layout) noexcept {
+    return FindBlock(layout, /*clear=*/kZeroing == Zeroing::OnFind);
   }
 
   Result<std::byte*> Find(std::size_t size) noexcept {
     return Find(Layout(size, internal::kMinimumAlignment));
   }
 
+  // Like |Find|, but the allocation is cleared regardless of |kZeroing|.
+  Result<std::byte*> FindZeroed(Layout layout) noexcept {
+    return FindBlock(layout, /*clear=*/true);
+  }
+
   Result<void> Return(std::byte* ptr) {
-    if (ptr == nullptr)
+    if constexpr (kSizeTracking == SizeTracking::ByCaller)
+      return cpp::fail(Error::OperationNotSupported);
+
+    BlockDescriptor* owner = FindOwner(ptr);
+    if (owner == nullptr)
       return cpp::fail(Error::InvalidInput);
 
-    std::byte* low = reinterpret_cast<std::byte*>(block_);
-    std::byte* high = reinterpret_cast<std::byte*>(block_) + block_->size;
-    if (ptr < low || ptr > high)
+    if (auto result = ReturnBlock(owner, internal::GetHeader<Header>(ptr));
+        result.has_error())
+      return cpp::fail(result.error());
+
+    return {};
+  }
+
+  // Return |ptr|, found with |layout|. Without per-allocation headers, this
+  // is the only way to return an allocation.
+  Result<void> Return(std::byte* ptr, Layout layout) {
+    if constexpr (kSizeTracking == SizeTracking::InHeader)
+      return Return(ptr);
+
+    BlockDescriptor* owner = FindOwner(ptr);
+    if (!IsValid(layout) || owner == nullptr)
       return cpp::fail(Error::InvalidInput);
 
-    auto block = internal::GetHeader(ptr);
-    if (!free_list_) {
-      // TODO: Should we zero out the content here?
-      free_list_ = block;
+    auto* block = reinterpret_cast<Header*>(ptr);
+    block->SetSize(GetRequestSize(layout));
+    block->SetNext(nullptr);
+    if (auto result = ReturnBlock(owner, block); result.has_error())
+      return cpp::fail(result.error());
+
+    return {};
+  }
+
+  // Fill |out| with allocations of |layout|. When the whole batch fits in a
+  // single block, it's carved out of one free block, found with a single
+  // search of the free list. Either every entry is filled or none are.
+  Result<void> FindBatch(Layout layout, std::span<std::byte*> out) noexcept {
+    if (!IsValid(layout))
+      return cpp::fail(Error::InvalidInput);
+
+    if (out.empty())
       return {};
-    }
 
-    auto prior_or = internal::FindPriorBlock(free_list_, block);
-    // TODO: Add better error here. When will this happen?
-    if (prior_or.has_error())
+    std::size_t request_size = GetRequestSize(layout);
+    std::size_t batch_size = request_size * out.size();
+
+    // Allocations carved out back to back are only aligned to the sizes of
+    // the ones before them.
+    if (batch_size / out.size() != request_size ||
+        batch_size > GetCapacity() ||
+        GetAlignment(layout) > internal::kMinimumAlignment) {
+      for (std::size_t i = 0; i < out.size(); ++i) {
+        auto ptr_or = Find(layout);
+        if (ptr_or.has_error()) {
+          // Return with |layout|, as headerless blocks don't know their size.
+          for (std::size_t j = 0; j < i; ++j) {
+            [[maybe_unused]] auto result = Return(out[j], layout);
+            assert(result.has_value());
+          }
+
+          return cpp::fail(ptr_or.error());
+        }
+
+        out[i] = ptr_or.value();
+      }
+
       return {};
+    }
 
-    auto prior = prior_or.value();
-    if (prior) {
-      auto next = prior->next;
-      prior->next = block;
-      block->next = next;
-      if (auto result = internal::CoalesceBlock(prior); result.has_error())
-        return cpp::fail(Error::Internal);
-    } else {
-      block->next = free_list_;
-      free_list_ = block;
-      if (auto result = internal::CoalesceBlock(free_list_); result.has_error())
+    auto fit_or = FindOrAddFreeBlock(batch_size);
+    if (fit_or.has_error())
+      return cpp::fail(fit_or.error());
+
+    // Every allocation is taken off the front of the same free block, so
+    // the remainder stays after the same |prev|.
+    Fit fit = fit_or.value();
+    for (std::size_t i = 0; i < out.size(); ++i) {
+      auto ptr_or = TakeBlock(fit, request_size, internal::kMinimumAlignment,
+                              /*clear=*/kZeroing == Zeroing::OnFind);
+      if (ptr_or.has_error())
+        return cpp::fail(ptr_or.error());
+
+      out[i] = ptr_or.value();
+      if (i + 1 < out.size()) {
+        Header* prev = fit.pair.prev;
+        fit.pair = internal::HeaderPair<Header>(
+            prev ? prev->GetNext() : fit.block->free_list, prev);
+      }
+    }
+
+    return {};
+  }
+
+  Result<void> ReturnBatch(std::span<std::byte*> ptrs) {
+    if constexpr (kSizeTracking == SizeTracking::ByCaller)
+      return cpp::fail(Error::OperationNotSupported);
+
+    for (std::byte* ptr : ptrs)
+      if (!Owns(ptr))
+        return cpp::fail(Error::InvalidInput);
+
+    for (std::byte* ptr : ptrs)
+      if (auto result = ReturnBlock(FindOwner(ptr),
+                                    internal::GetHeader<Header>(ptr));
+          result.has_error())
+        return cpp::fail(result.error());
+
+    return {};
+  }
+
+  // Resize the allocation at |ptr| in place. Growing absorbs the free block
+  // physically following the allocation, if there's one large enough, and
+  // shrinking hands the excess back to the free list. Fails with
+  // |Error::NoFreeBlock| if the allocation can't be resized in place. Blocks
+  // held in fast bins or awaiting a merge pass aren't absorbed.
+  Result<void> Resize(std::byte* ptr, Layout layout) {
+    if constexpr (kSizeTracking == SizeTracking::ByCaller)
+      return cpp::fail(Error::OperationNotSupported);
+
+    BlockDescriptor* owner = FindOwner(ptr);
+    if (!IsValid(layout) || owner == nullptr)
+      return cpp::fail(Error::InvalidInput);
+
+    if (internal::AsUint(ptr) % layout.alignment != 0)
+      return cpp::fail(Error::NoFreeBlock);
+
+    std::size_t request_size = GetRequestSize(layout);
+    auto* block = internal::GetHeader<Header>(ptr);
+    if (request_size > block->GetSize()) {
+      Header* free_list = owner->free_list;
+      if (free_list == nullptr)
+        return cpp::fail(Error::NoFreeBlock);
+
+      auto* neighbor = internal::PtrAdd(block, block->GetSize());
+      auto prev_or = internal::FindPriorBlock(free_list, neighbor);
+      if (prev_or.has_error())
         return cpp::fail(Error::Internal);
+
+      auto* prev = prev_or.value();
+      auto* candidate = prev ? prev->GetNext() : free_list;
+      if (candidate != neighbor ||
+          block->GetSize() + neighbor->GetSize() < request_size)
+        return cpp::fail(Error::NoFreeBlock);
+
+      Unindex(neighbor);
+      if (prev)
+        prev->SetNext(neighbor->GetNext());
+      else
+        owner->free_list = neighbor->GetNext();
+
+      SetPrev(neighbor->GetNext(), prev);
+
+      if (kNextFit && rover_.prev == neighbor)
+        rover_.prev = prev;
+
+      block->SetSize(block->GetSize() + neighbor->GetSize());
+      MarkWritten(owner, internal::AsBytePtr(block) + block->GetSize());
     }
 
-    if (free_list_->size == GetAlignedSize()) {
-      // TODO: Add error handling.
-      (void)ReleaseAllBlocks(block_);
-      // free_list_ = block_ = nullptr;
+    return TrimBlock(owner, block, request_size);
+  }
+
+  // Invalidate all allocations at once, in time proportional to the number
+  // of blocks rather than allocations. Blocks are released back to
+  // |Provider|, or kept for further allocations, per |mode|.
+  Result<void> Reset(ResetMode mode = ResetMode::ReleaseBlocks) {
+    if (blocks_ == nullptr)
+      return {};
+
+    rover_ = Rover();
+    index_.Clear();
+    fast_bins_ = {};
+    if (mode == ResetMode::KeepBlocks) {
+      for (auto* block = blocks_; block != nullptr; block = block->next)
+        InitializeBlock(block);
+
+      return {};
     }
 
+    if (auto result = ReleaseAllBlocks(); result.has_error())
+      return cpp::fail(result.error());
+
     return {};
   }
 
+  // Merge every returned block that isn't in the free lists yet, whether in
+  // a fast bin or left uncoalesced by |Coalescing::Deferred|, into them.
+  Result<void> Compact() {
+    if (auto result = Consolidate(); result.has_error())
+      return cpp::fail(result.error());
+
+    return RetainBlocks();
+  }
+
+  // Release every block without any allocations back to |Provider|,
+  // regardless of |kRetainedBlocks|.
+  Result<void> Trim() {
+    if (auto result = Consolidate(); result.has_error())
+      return cpp::fail(result.error());
+
+    return ReleaseEmptyBlocks(/*retained=*/0);
+  }
+
+  bool Owns(std::byte* ptr) const { return FindOwner(ptr) != nullptr; }
+
   constexpr bool AcceptsAlignment() const { return true; }
 
-  constexpr bool AcceptsReturn() const { return false; }
+  constexpr bool AcceptsReturn() const { return true; }
 
 private:
+  using Header = std::conditional_t<kHeaderLayout == HeaderLayout::Compact,
+                                    internal::CompactBlockHeader,
+                                    internal::BlockHeader>;
+
+  static constexpr std::size_t kHeaderSize =
+      internal::GetBlockHeaderSize<Header>();
+
+  // Kept at the start of every block fetched from |Provider|.
+  struct BlockDescriptor {
+    // The next block fetched from |Provider|.
+    BlockDescriptor* next = nullptr;
+
+    // Address-ordered list of the free space in this block. Every block
+    // keeps a list of its own, so that headers only ever link to headers in
+    // the same block, as |internal::CompactBlockHeader| requires.
+    Header* free_list = nullptr;
+
+    // Returned blocks yet to be merged into |free_list|, in no particular
+    // order. Only kept with |Coalescing::Deferred|.
+    [[no_unique_address]] std::conditional_t<
+        kCoalescing == Coalescing::Deferred, Header*, std::monostate>
+        deferred = {};
+  };
+
+  // Position the next-fit search resumes from: right after |prev| in the
+  // free list of |block|, or at its head if |prev| is nullptr.
+  struct Rover {
+    BlockDescriptor* block = nullptr;
+    Header* prev = nullptr;
+  };
+
+  // A free block, |pair|, in the free list of |block|.
+  struct Fit {
+    BlockDescriptor* block;
+    internal::HeaderPair<Header> pair;
+  };
+
+  // Kept in every free block in |index_|, so that a block found there can be
+  // taken off its free list without a search.
+  struct IndexEntry {
+    BlockDescriptor* owner;
+    Header* prev;
+  };
+
+  using SizeIndex = internal::SizeTree<Header, IndexEntry>;
+
+  // Kept in the first bytes of a block in a fast bin, in place of its
+  // header. Bins link blocks from any block of |Provider|, which compact
+  // headers can't.
+  struct FastBlock {
+    FastBlock* next;
+  };
+
+  // Returned blocks of a single size, most recent first.
+  struct FastBin {
+    FastBlock* head = nullptr;
+    std::size_t count = 0;
+  };
+
+  static constexpr std::size_t kFastBinCount =
+      kFastBinsMaxSize ? kFastBinsMaxSize / internal::kMinimumAlignment + 1
+                       : 0;
+
+  // Bytes at the start of every block taken by its |BlockDescriptor|,
+  // padded so that headers after it are aligned to their own size.
+  static constexpr std::size_t kDescriptorSize =
+      internal::AlignUp(sizeof(BlockDescriptor), kHeaderSize);
+
+  // Smallest free block that can be split off an allocation.
+  static constexpr std::size_t kMinimumFreeSize =
+      kSizeTracking == SizeTracking::ByCaller
+          ? kHeaderSize
+          : internal::AlignUp(kHeaderSize + 1, internal::kMinimumAlignment);
+
   // Ultimate size of the blocks after accounting for header and alignment.
   [[nodiscard]] static constexpr std::size_t GetAlignedSize() {
     return Provider::GetBlockSize();
   }
 
-  internal::VirtualAddressRange CreateAllocation(std::byte* base) {
-    return internal::VirtualAddressRange{
-        .address = reinterpret_cast<std::uint64_t>(base),
-        .count = GetAlignedSize()};
+  // Number of bytes in every block available for allocations.
+  [[nodiscard]] static constexpr std::size_t GetCapacity() {
+    std::size_t capacity = GetAlignedSize() - kDescriptorSize;
+    if constexpr (kSizeTracking == SizeTracking::ByCaller)
+      return internal::AlignDown(capacity, kHeaderSize);
+
+    return capacity;
   }
 
-  Result<internal::BlockHeader*>
-  AllocateNewBlock(internal::BlockHeader* next = nullptr) {
-    Result<std::byte*> base_or = provider_.get().Provide(GetAlignedSize());
+  Result<BlockDescriptor*> AllocateNewBlock(BlockDescriptor* next = nullptr) {
+    Result<std::byte*> base_or = provider_.get().Provide(1);
 
     if (base_or.has_error())
       return cpp::fail(base_or.error());
 
-    auto allocation = internal::VirtualAddressRange{
-        .address = reinterpret_cast<std::uint64_t>(base_or.value()),
-        .count = GetAlignedSize()};
-    return internal::BlockHeader::Create(allocation, next);
+    auto* block = reinterpret_cast<BlockDescriptor*>(base_or.value());
+    block->next = next;
+    block->free_list = nullptr;
+    block->deferred = {};
+    return block;
+  }
+
+  Result<void> ReleaseAllBlocks() {
+    while (blocks_ != nullptr) {
+      BlockDescriptor* next = blocks_->next;
+      auto result = provider_.get().Return(internal::AsBytePtr(blocks_));
+      if (result.has_error()) {
+        DERROR("Block release failed: " << (int)result.error());
+        return cpp::fail(Error::Internal);
+      }
+
+      blocks_ = next;
+    }
+
+    return {};
   }
 
-  Result<void> ReleaseBlock(internal::BlockHeader* block) { return {}; }
+  // Whether |block| has no allocations, i.e. its free list spans all of it.
+  static bool IsEmptyBlock(BlockDescriptor* block) {
+    return block->free_list != nullptr &&
+           block->free_list->GetSize() == GetCapacity();
+  }
+
+  // Release the empty blocks past the |retained| most recently fetched ones
+  // back to |Provider|.
+  Result<void> ReleaseEmptyBlocks(std::size_t retained) {
+    BlockDescriptor* head = blocks_;
+    std::size_t empty = 0;
+    for (BlockDescriptor** link = &blocks_; *link != nullptr;) {
+      BlockDescriptor* block = *link;
+      if (!IsEmptyBlock(block) || empty++ < retained) {
+        link = &block->next;
+        continue;
+      }
+
+      *link = block->next;
+      Unindex(block->free_list);
+      if (rover_.block == block)
+        rover_ = Rover();
 
-  Result<void> ReleaseAllBlocks(internal::BlockHeader* block,
-                                internal::BlockHeader* sentinel = nullptr) {
-    auto release = [&](std::byte* p) -> internal::Failable<void> {
-      auto result = provider_.get().Return(p);
+      auto result = provider_.get().Return(internal::AsBytePtr(block));
       if (result.has_error()) {
         DERROR("Block release failed: " << (int)result.error());
-        return cpp::fail(internal::Failure::ReleaseFailed);
+        return cpp::fail(Error::Internal);
       }
+    }
 
-      return {};
-    };
-    if (auto result =
-            internal::ReleaseBlockList(block, std::move(release), sentinel);
-        result.has_error())
-      return cpp::fail(Error::Internal);
+    // Nothing is known about the bytes of an older block.
+    if (blocks_ != head)
+      untouched_ = blocks_ ? internal::AsBytePtr(blocks_) + GetAlignedSize()
+                           : nullptr;
 
     return {};
   }
 
+  // Release the empty blocks past |kRetainedBlocks|. Only called after
+  // allocations are returned: blocks emptied while searching for a free
+  // block are about to be used again.
+  Result<void> RetainBlocks() {
+    if constexpr (kRetainedBlocks == std::numeric_limits<std::size_t>::max())
+      return {};
+
+    return ReleaseEmptyBlocks(kRetainedBlocks);
+  }
+
+  // Block fetched from |Provider| that contains |ptr|, if any.
+  BlockDescriptor* FindOwner(std::byte* ptr) const {
+    if (ptr == nullptr)
+      return nullptr;
+
+    for (auto* itr = blocks_; itr != nullptr; itr = itr->next) {
+      std::byte* low = internal::AsBytePtr(itr);
+      if (ptr >= low && ptr < low + GetAlignedSize())
+        return itr;
+    }
+
+    return nullptr;
+  }
+
   // Various assertions hidden from user API but added here to ensure invariants
   // are met at compile time.
   static_assert(internal::IsPowerOfTwo(kAlignment),
                 "kAlignment must be a power of 2.");
 
-  static constexpr auto GetFindBlockFn() {
-    return kSearchStrategy == FindBy::FirstFit  ? internal::FindBlockByFirstFit
-           : kSearchStrategy == FindBy::BestFit ? internal::FindBlockByBestFit
-                                                : internal::FindBlockByWorstFit;
+  static_assert(kHeaderLayout == HeaderLayout::Standard ||
+                    Provider::GetBlockSize() <=
+                        std::numeric_limits<std::int32_t>::max(),
+                "Compact headers require blocks under 2GB.");
+
+  using FitPolicy = decltype(GetFitPolicy<kSearchStrategy>());
+
+  static_assert(internal::FitPolicyTrait<FitPolicy, Header>,
+                "SearchT must be one of FindBy or a fit policy.");
+
+  static constexpr bool kNextFit =
+      IsSearch<kSearchStrategy, FindBy::NextFit>();
+
+  // Whether free blocks are indexed by size. Only best-fit and worst-fit
+  // searches make use of the index.
+  static constexpr bool kIndexed =
+      kIndexThreshold != 0 &&
+      (IsSearch<kSearchStrategy, FindBy::BestFit>() ||
+       IsSearch<kSearchStrategy, FindBy::WorstFit>());
+
+  static_assert(kIndexThreshold == 0 ||
+                    kIndexThreshold >= SizeIndex::kMinimumBlockSize,
+                "IndexThresholdT must leave room for a node of the index.");
+
+  // Bytes at the start of a free block that may hold its metadata: its
+  // header, and its node in |index_| if it's large enough to have one.
+  static constexpr std::size_t kFreeMetadataSize =
+      kHeaderSize + (kIndexed ? sizeof(typename SizeIndex::Node) : 0);
+
+  // Whether |FitPolicy| can choose among candidates from several blocks.
+  static constexpr bool kComparesFits =
+      requires(std::size_t a, std::size_t b) { FitPolicy::Prefer(a, b); };
+
+  // Find a free block of at least |request_size| bytes in |block|.
+  Result<std::optional<internal::HeaderPair<Header>>>
+  FindFreeBlock(BlockDescriptor* block, std::size_t request_size) {
+    if (block->free_list == nullptr)
+      return std::nullopt;
+
+    auto result = FitPolicy::Find(block->free_list, request_size);
+    if (result.has_error())
+      return cpp::fail(Error::Internal);
+
+    return result.value();
   }
 
-  // TODO: Make this thread safe.
-  Result<void> InitBlockIfUnset() {
-    if (block_)
-      return {};
+  // Find a free block of at least |request_size| bytes across all blocks.
+  Result<std::optional<Fit>> FindFreeBlock(std::size_t request_size) {
+    if constexpr (kNextFit)
+      return FindNextFreeBlock(request_size);
+
+    if constexpr (kIndexed)
+      if (IsServedByIndex(request_size))
+        return FindIndexedBlock(request_size);
+
+    std::optional<Fit> target = std::nullopt;
+    for (auto* block = blocks_; block != nullptr; block = block->next) {
+      auto pair_or = FindFreeBlock(block, request_size);
+      if (pair_or.has_error())
+        return cpp::fail(pair_or.error());
+
+      if (!pair_or.value().has_value())
+        continue;
+
+      Fit fit = {.block = block, .pair = pair_or.value().value()};
+      if constexpr (!kComparesFits) {
+        return fit;
+      } else if (!target.has_value() ||
+                 FitPolicy::Prefer(fit.pair.header->GetSize(),
+                                   target->pair.header->GetSize())) {
+        target = fit;
+      }
+    }
+
+    return target;
+  }
+
+  // Whether the search for |request_size| bytes can be left to |index_|.
+  // Every best-fit candidate of |kIndexThreshold| bytes or more is indexed,
+  // as is the worst-fit candidate whenever any block is.
+  bool IsServedByIndex(std::size_t request_size) const {
+    if constexpr (IsSearch<kSearchStrategy, FindBy::BestFit>())
+      return request_size >= kIndexThreshold;
 
-    auto new_block_or = AllocateNewBlock();
+    return !index_.IsEmpty();
+  }
+
+  // Find a free block of at least |request_size| bytes in |index_|.
+  std::optional<Fit> FindIndexedBlock(std::size_t request_size) {
+    Header* header = IsSearch<kSearchStrategy, FindBy::BestFit>()
+                         ? index_.LowerBound(request_size)
+                         : index_.Max();
+    if (header == nullptr || header->GetSize() < request_size)
+      return std::nullopt;
+
+    IndexEntry& entry = SizeIndex::GetData(header);
+    return Fit{.block = entry.owner,
+               .pair = internal::HeaderPair(header, entry.prev)};
+  }
+
+  // Find the first free block of at least |request_size| bytes past
+  // |rover_|, wrapping around to the blocks, and the part of the free list,
+  // before it.
+  std::optional<Fit> FindNextFreeBlock(std::size_t request_size) {
+    if (blocks_ == nullptr)
+      return std::nullopt;
+
+    BlockDescriptor* start = rover_.block ? rover_.block : blocks_;
+    Header* prev = rover_.block ? rover_.prev : nullptr;
+    Header* resume = prev ? prev->GetNext() : start->free_list;
+    auto wrap = [&](BlockDescriptor* block) {
+      return block->next ? block->next : blocks_;
+    };
+
+    if (auto fit = FindFirstFit(start, prev, resume, nullptr, request_size))
+      return fit;
+
+    for (auto* block = wrap(start); block != start; block = wrap(block))
+      if (auto fit = FindFirstFit(block, nullptr, block->free_list, nullptr,
+                                  request_size))
+        return fit;
+
+    return FindFirstFit(start, nullptr, start->free_list, resume,
+                        request_size);
+  }
+
+  // Find the first free block of at least |request_size| bytes in the free
+  // list of |block|, from |begin| up to but excluding |end|. |prev| is the
+  // block preceding |begin|.
+  static std::optional<Fit> FindFirstFit(BlockDescriptor* block, Header* prev,
+                                         Header* begin, Header* end,
+                                         std::size_t request_size) {
+    for (Header* itr = begin; itr != end; prev = itr, itr = itr->GetNext())
+      if (itr->GetSize() >= request_size)
+        return Fit{.block = block, .pair = internal::HeaderPair(itr, prev)};
+
+    return std::nullopt;
+  }
+
+  // Serve |layout|, zeroing the allocation if |clear| is set.
+  Result<std::byte*> FindBlock(Layout layout, bool clear) {
+    if (!IsValid(layout))
+      return cpp::fail(Error::InvalidInput);
+
+    std::size_t request_size = GetRequestSize(layout);
+    std::size_t alignment = GetAlignment(layout);
+    if (request_size > GetCapacity())
+      return cpp::fail(Error::SizeRequestTooLarge);
+
+    if (Header* header = PopFastBlock(request_size, alignment)) {
+      std::byte* ptr = GetAllocation(header);
+      if (clear)
+        ClearBytes(nullptr, ptr, internal::AsBytePtr(header) + request_size);
+
+      return ptr;
+    }
+
+    auto first_fit_or = FindOrAddFreeBlock(request_size, alignment);
+    if (first_fit_or.has_error())
+      return cpp::fail(first_fit_or.error());
+
+    return TakeBlock(first_fit_or.value(), request_size, alignment, clear);
+  }
+
+  // Number of bytes taken out of the free list to serve |layout|, not
+  // counting any padding in front for alignment. Without per-allocation
+  // headers, sizes are kept at multiples of the header size, so that both
+  // allocations and any remainder can hold a free block header once
+  // returned.
+  static constexpr std::size_t GetRequestSize(Layout layout) {
+    if constexpr (kSizeTracking == SizeTracking::ByCaller)
+      return internal::AlignUp(std::max(layout.size, kHeaderSize),
+                               kHeaderSize);
+
+    return internal::AlignUp(layout.size + kHeaderSize,
+                             internal::kMinimumAlignment);
+  }
+
+  // Alignment of the allocation serving |layout|.
+  static constexpr std::size_t GetAlignment(Layout layout) {
+    return std::max(layout.alignment, kAlignment);
+  }
+
+  // Bytes to leave in front of free block |header| for its allocation to be
+  // aligned to |alignment|: either none, or enough to stay on the free list
+  // as a block of their own.
+  static std::size_t GetPadding(Header* header, std::size_t alignment) {
+    std::uintptr_t begin = internal::AsUint(GetAllocation(header));
+    std::size_t padding = internal::AlignUp(begin, alignment) - begin;
+    while (padding != 0 && padding < kMinimumFreeSize)
+      padding += alignment;
+
+    return padding;
+  }
+
+  // Whether free block |header| can serve |request_size| bytes aligned to
+  // |alignment|.
+  static bool CanServe(Header* header, std::size_t request_size,
+                       std::size_t alignment) {
+    return GetPadding(header, alignment) + request_size <= header->GetSize();
+  }
+
+  // Find a free block that can serve |request_size| bytes aligned to
+  // |alignment| with |search|, which finds a free block of at least the
+  // given size. A block of the exact size is tried first, then one large
+  // enough for any padding.
+  template <class Search>
+  static Result<std::optional<Fit>> FindAlignedFit(std::size_t request_size,
+                                                   std::size_t alignment,
+                                                   Search search) {
+    Result<std::optional<Fit>> fit_or = search(request_size);
+    if (fit_or.has_error() || !fit_or.value().has_value() ||
+        CanServe(fit_or.value()->pair.header, request_size, alignment))
+      return fit_or;
+
+    return search(request_size + kMinimumFreeSize + alignment);
+  }
+
+  // Find a free block that can serve |request_size| bytes aligned to
+  // |alignment|, fetching a new block from |Provider| if there's none.
+  Result<Fit> FindOrAddFreeBlock(
+      std::size_t request_size,
+      std::size_t alignment = internal::kMinimumAlignment) {
+    auto search = [this](std::size_t size) { return FindFreeBlock(size); };
+    auto fit_or_error = FindAlignedFit(request_size, alignment, search);
+    if (fit_or_error.has_error())
+      return cpp::fail(fit_or_error.error());
+
+    if (fit_or_error.value().has_value())
+      return fit_or_error.value().value();
+
+    // Coalescing the blocks held out of the free lists may turn up a large
+    // enough one.
+    auto merged_or = Consolidate();
+    if (merged_or.has_error())
+      return cpp::fail(merged_or.error());
+
+    if (merged_or.value()) {
+      fit_or_error = FindAlignedFit(request_size, alignment, search);
+      if (fit_or_error.has_error())
+        return cpp::fail(fit_or_error.error());
+
+      if (fit_or_error.value().has_value())
+        return fit_or_error.value().value();
+    }
+
+    if (auto result = AddBlock(); result.has_error())
+      return cpp::fail(result.error());
+
+    fit_or_error = FindAlignedFit(
+        request_size, alignment,
+        [this](std::size_t size) -> Result<std::optional<Fit>> {
+          auto pair_or = FindFreeBlock(blocks_, size);
+          if (pair_or.has_error())
+            return cpp::fail(pair_or.error());
+
+          if (!pair_or.value().has_value())
+            return std::nullopt;
+
+          return Fit{.block = blocks_, .pair = pair_or.value().value()};
+        });
+    if (fit_or_error.has_error())
+      return cpp::fail(fit_or_error.error());
+
+    if (!fit_or_error.value().has_value() ||
+        !CanServe(fit_or_error.value()->pair.header, request_size, alignment))
+      return cpp::fail(Error::NoFreeBlock);
+
+    return fit_or_error.value().value();
+  }
+
+  // Hand out |request_size| bytes of free block |fit|, aligned to
+  // |alignment|, leaving the rest of it in its place in the free list. Any
+  // padding needed in front stays on the free list as a block of its own.
+  // With |clear| set, the bytes handed out are zeroed.
+  Result<std::byte*> TakeBlock(Fit fit, std::size_t request_size,
+                               std::size_t alignment, bool clear) {
+    Header* header = fit.pair.header;
+    Unindex(header);
+    if (std::size_t padding = GetPadding(header, alignment)) {
+      Header* front = header;
+      header = internal::PtrAdd(front, padding);
+      header->SetSize(front->GetSize() - padding);
+      header->SetNext(front->GetNext());
+      front->SetSize(padding);
+      front->SetNext(header);
+      Index(fit.block, front, fit.pair.prev);
+      fit.pair = internal::HeaderPair(header, front);
+    }
+
+    Header* next = header->GetNext();
+    Header* new_header = nullptr;
+    if constexpr (kSizeTracking == SizeTracking::ByCaller) {
+      // Sizes are multiples of the header size, so any remainder is large
+      // enough to stay on the free list.
+      new_header = header->GetNext();
+      if (header->GetSize() > request_size) {
+        new_header = internal::PtrAdd(header, request_size);
+        new_header->SetSize(header->GetSize() - request_size);
+        new_header->SetNext(header->GetNext());
+      }
+    } else {
+      auto new_header_or = internal::SplitBlock(header, request_size,
+                                                internal::kMinimumAlignment);
+
+      // TODO: This should never occur. Also, if it is in fact possible,
+      // we should log the error before dropping it on the ground.
+      if (new_header_or.has_error())
+        return cpp::fail(Error::Internal);
+
+      // The block wasn't large enough to split, so it's handed out whole.
+      new_header = new_header_or.value();
+      if (new_header == nullptr)
+        new_header = header->GetNext();
+    }
+
+    if (header == fit.block->free_list)
+      fit.block->free_list = new_header;
+    else if (fit.pair.prev)
+      fit.pair.prev->SetNext(new_header);
+
+    if (new_header != next) {
+      Index(fit.block, new_header, fit.pair.prev);
+      SetPrev(next, new_header);
+    } else {
+      SetPrev(next, fit.pair.prev);
+    }
+
+    // The next search resumes with whatever is left of this free block.
+    if constexpr (kNextFit)
+      rover_ = Rover{.block = fit.block, .prev = fit.pair.prev};
+
+    header->SetNext(nullptr);
+    std::byte* ptr = GetAllocation(header);
+    std::byte* end = internal::AsBytePtr(header) + header->GetSize();
+    if (clear)
+      ClearBytes(fit.block, ptr, end);
+
+    MarkWritten(fit.block, end);
+    return ptr;
+  }
+
+  // Pointer handed out for allocated |header|.
+  static std::byte* GetAllocation(Header* header) {
+    if constexpr (kSizeTracking == SizeTracking::ByCaller)
+      return internal::AsBytePtr(header);
+
+    return internal::GetBlock(header);
+  }
+
+  // Zero the bytes from |begin| to |end| in |owner|, skipping those known
+  // to be zero already. Without an |owner|, every byte is zeroed.
+  void ClearBytes(BlockDescriptor* owner, std::byte* begin, std::byte* end) {
+    std::byte* untouched = owner == blocks_ ? untouched_ : end;
+    if (begin < untouched)
+      std::memset(begin, 0, std::min(end, untouched) - begin);
+  }
+
+  // Note that the bytes of |owner| up to |end| may be written to, along with
+  // the metadata of a free block right after them.
+  void MarkWritten(BlockDescriptor* owner, std::byte* end) {
+    if (owner != blocks_)
+      return;
+
+    std::byte* limit = internal::AsBytePtr(blocks_) + GetAlignedSize();
+    untouched_ =
+        std::max(untouched_, std::min(end + kFreeMetadataSize, limit));
+  }
+
+  // Fetch a new block from |Provider| and add its space to the free list.
+  // Space never coalesces across neighboring blocks, as each one starts
+  // with its own |BlockDescriptor|.
+  // TODO: Make this thread safe.
+  Result<void> AddBlock() {
+    auto new_block_or = AllocateNewBlock(blocks_);
     if (new_block_or.has_error())
       return cpp::fail(new_block_or.error());
 
-    block_ = new_block_or.value();
-    free_list_ = internal::PtrAdd(block_, internal::GetBlockHeaderSize());
-    free_list_->next = nullptr;
-    free_list_->size = block_->size - internal::GetBlockHeaderSize();
+    blocks_ = new_block_or.value();
+    InitializeBlock(blocks_);
+
+    // Only the metadata of the free block has been written to a zero-filled
+    // block.
+    untouched_ = ZeroedProviderTrait<Provider>
+                     ? internal::AsBytePtr(blocks_->free_list) +
+                           kFreeMetadataSize
+                     : internal::AsBytePtr(blocks_) + GetAlignedSize();
+    return {};
+  }
+
+  // Turn all of |block| into a single free span, discarding its contents.
+  void InitializeBlock(BlockDescriptor* block) {
+    auto* free_block = reinterpret_cast<Header*>(internal::AsBytePtr(block) +
+                                                 kDescriptorSize);
+    free_block->SetNext(nullptr);
+    free_block->SetSize(GetCapacity());
+    block->free_list = free_block;
+    block->deferred = {};
+    Index(block, free_block, nullptr);
+  }
+
+  // Hand the bytes of allocated |block| past |size| back to the free list of
+  // |owner|, if there are enough of them to form a block of their own.
+  Result<void> TrimBlock(BlockDescriptor* owner, Header* block,
+                         std::size_t size) {
+    if (block->GetSize() - size < kMinimumFreeSize)
+      return {};
+
+    auto* tail = internal::PtrAdd(block, size);
+    tail->SetSize(block->GetSize() - size);
+    tail->SetNext(nullptr);
+    block->SetSize(size);
+    if constexpr (kZeroing == Zeroing::OnReturn)
+      internal::ZeroBlock(tail);
+
+    return InsertFreeBlock(owner, tail);
+  }
+
+  // Hand allocated |block| back to |owner|, through a fast bin if it's small
+  // enough.
+  Result<void> ReturnBlock(BlockDescriptor* owner, Header* block) {
+    if constexpr (kZeroing == Zeroing::OnReturn)
+      internal::ZeroBlock(block);
+
+    if (IsFastBinned(block->GetSize()))
+      return PushFastBlock(block);
+
+    if (auto result = ReleaseBlock(owner, block); result.has_error())
+      return cpp::fail(result.error());
+
+    return IsEmptyBlock(owner) ? RetainBlocks() : Result<void>();
+  }
+
+  // Hand returned |block| over to the free list of |owner|, or leave it for
+  // the next merge pass with |Coalescing::Deferred|.
+  Result<void> ReleaseBlock(BlockDescriptor* owner, Header* block) {
+    if constexpr (kCoalescing == Coalescing::Deferred) {
+      block->SetNext(owner->deferred);
+      owner->deferred = block;
+      return {};
+    }
+
+    return InsertFreeBlock(owner, block);
+  }
+
+  // Merge every block held out of the free lists into them, returning
+  // whether there were any.
+  Result<bool> Consolidate() {
+    auto merged_or = FlushFastBins();
+    if (merged_or.has_error())
+      return cpp::fail(merged_or.error());
+
+    bool merged = merged_or.value();
+    if constexpr (kCoalescing == Coalescing::Deferred) {
+      for (auto* block = blocks_; block != nullptr; block = block->next) {
+        if (block->deferred == nullptr)
+          continue;
+
+        if (auto result = MergeDeferredBlocks(block); result.has_error())
+          return cpp::fail(result.error());
+
+        merged = true;
+      }
+    }
+
+    return merged;
+  }
+
+  // Sort the deferred blocks of |owner| by address, then merge them into
+  // its free list in a single pass over both.
+  Result<void> MergeDeferredBlocks(BlockDescriptor* owner) {
+    Header* block = internal::SortBlocksByAddress(owner->deferred);
+    owner->deferred = nullptr;
+
+    Header* prior_prev = nullptr;
+    Header* prior = nullptr;
+    while (block != nullptr) {
+      Header* next = block->GetNext();
+      for (Header* itr = prior ? prior->GetNext() : owner->free_list;
+           itr != nullptr && internal::AsUint(itr) < internal::AsUint(block);
+           itr = itr->GetNext()) {
+        prior_prev = prior;
+        prior = itr;
+      }
+
+      auto survivor_or = LinkFreeBlock(owner, block, prior, prior_prev);
+      if (survivor_or.has_error())
+        return cpp::fail(survivor_or.error());
+
+      if (survivor_or.value() == block) {
+        prior_prev = prior;
+        prior = block;
+      }
+
+      block = next;
+    }
+
+    return {};
+  }
+
+  // Whether returned blocks of |size| bytes go to a fast bin.
+  static constexpr bool IsFastBinned(std::size_t size) {
+    return size <= kFastBinsMaxSize && size % internal::kMinimumAlignment == 0;
+  }
+
+  FastBin& GetFastBin(std::size_t size) {
+    return fast_bins_[size / internal::kMinimumAlignment];
+  }
+
+  // Push returned |block| onto its fast bin, flushing the bin if it's grown
+  // past |kFastBinDepth| blocks.
+  Result<void> PushFastBlock(Header* block) {
+    std::size_t size = block->GetSize();
+    FastBin& bin = GetFastBin(size);
+    auto* fast_block = reinterpret_cast<FastBlock*>(block);
+    fast_block->next = bin.head;
+    bin.head = fast_block;
+    if (++bin.count <= kFastBinDepth)
+      return {};
+
+    if (auto result = FlushFastBin(size); result.has_error())
+      return cpp::fail(result.error());
+
+    return RetainBlocks();
+  }
+
+  // Pop the most recently returned block of |size| bytes, if there's one and
+  // its allocation is aligned to |alignment|.
+  Header* PopFastBlock(std::size_t size, std::size_t alignment) {
+    if (!IsFastBinned(size))
+      return nullptr;
+
+    FastBin& bin = GetFastBin(size);
+    auto* header = reinterpret_cast<Header*>(bin.head);
+    if (header == nullptr ||
+        internal::AsUint(GetAllocation(header)) % alignment != 0)
+      return nullptr;
+
+    bin.head = bin.head->next;
+    --bin.count;
+    header->SetSize(size);
+    header->SetNext(nullptr);
+    return header;
+  }
+
+  // Hand every block in the fast bin of |size| bytes over to the free lists,
+  // coalescing them with their neighbors.
+  Result<void> FlushFastBin(std::size_t size) {
+    FastBin& bin = GetFastBin(size);
+    while (bin.head != nullptr) {
+      auto* header = reinterpret_cast<Header*>(bin.head);
+      bin.head = bin.head->next;
+      --bin.count;
+      header->SetSize(size);
+      header->SetNext(nullptr);
+      if (auto result =
+              ReleaseBlock(FindOwner(internal::AsBytePtr(header)), header);
+          result.has_error())
+        return cpp::fail(result.error());
+    }
+
+    return {};
+  }
+
+  // Flush every fast bin, returning whether any held a block.
+  Result<bool> FlushFastBins() {
+    bool flushed = false;
+    for (std::size_t i = 0; i < kFastBinCount; ++i) {
+      if (fast_bins_[i].head == nullptr)
+        continue;
+
+      if (auto result = FlushFastBin(i * internal::kMinimumAlignment);
+          result.has_error())
+        return cpp::fail(result.error());
+
+      flushed = true;
+    }
+
+    return flushed;
+  }
+
+  // Insert |block| into the address-ordered free list of |owner|, coalescing
+  // it with its neighbors.
+  Result<void> InsertFreeBlock(BlockDescriptor* owner, Header* block) {
+    Header* prior_prev = nullptr;
+    Header* prior = nullptr;
+    for (Header* itr = owner->free_list;
+         itr != nullptr && internal::AsUint(itr) < internal::AsUint(block);
+         itr = itr->GetNext()) {
+      prior_prev = prior;
+      prior = itr;
+    }
+
+    if (auto result = LinkFreeBlock(owner, block, prior, prior_prev);
+        result.has_error())
+      return cpp::fail(result.error());
+
     return {};
   }
 
+  // Link |block| into the free list of |owner| right after |prior|, itself
+  // preceded by |prior_prev|, coalescing it with its neighbors. Returns the
+  // free block that |block| is now part of.
+  Result<Header*> LinkFreeBlock(BlockDescriptor* owner, Header* block,
+                                Header* prior, Header* prior_prev) {
+    if (prior) {
+      block->SetNext(prior->GetNext());
+      prior->SetNext(block);
+    } else {
+      block->SetNext(owner->free_list);
+      owner->free_list = block;
+    }
+
+    if (auto result = MergeFreeBlock(owner, block, prior); result.has_error())
+      return cpp::fail(result.error());
+
+    if (prior == nullptr || internal::AsBytePtr(prior) + prior->GetSize() !=
+                                internal::AsBytePtr(block))
+      return block;
+
+    // |block| borders on |prior|, which then needs indexing anew.
+    Unindex(prior);
+    if (auto result = MergeFreeBlock(owner, prior, prior_prev);
+        result.has_error())
+      return cpp::fail(result.error());
+
+    return prior;
+  }
+
+  // Coalesce free |block|, which isn't in |index_|, with the free blocks
+  // right after it, then index it. |prev| precedes it in the free list of
+  // |owner|.
+  Result<void> MergeFreeBlock(BlockDescriptor* owner, Header* block,
+                              Header* prev) {
+    if constexpr (kIndexed) {
+      std::byte* end = internal::AsBytePtr(block) + block->GetSize();
+      for (Header* itr = block->GetNext(); internal::AsBytePtr(itr) == end;
+           itr = itr->GetNext()) {
+        end += itr->GetSize();
+        Unindex(itr);
+      }
+    }
+
+    if (auto result = internal::CoalesceBlock(block); result.has_error())
+      return cpp::fail(Error::Internal);
+
+    KeepRover(owner, block);
+    Index(owner, block, prev);
+    SetPrev(block->GetNext(), block);
+    return {};
+  }
+
+  // Whether free |block| is, or is to be, in |index_|.
+  bool IsIndexed(Header* block) const {
+    return kIndexed && block->GetSize() >= kIndexThreshold;
+  }
+
+  // Add free |block| of |owner| to |index_|, if it's large enough. |prev|
+  // precedes it in the free list of |owner|.
+  void Index(BlockDescriptor* owner, Header* block, Header* prev) {
+    if (IsIndexed(block))
+      index_.Insert(block, IndexEntry{.owner = owner, .prev = prev});
+  }
+
+  // Remove free |block| from |index_|, if it's in there. Must be called
+  // before |block| changes size or leaves the free list.
+  void Unindex(Header* block) {
+    if (IsIndexed(block))
+      index_.Erase(block);
+  }
+
+  // Note that |prev| now precedes free |block|, if any, in its free list.
+  void SetPrev(Header* block, Header* prev) {
+    if (block != nullptr && IsIndexed(block))
+      SizeIndex::GetData(block).prev = prev;
+  }
+
+  // Point |rover_| at |survivor| if the header it pointed at was just merged
+  // into it.
+  void KeepRover(BlockDescriptor* owner, Header* survivor) {
+    if constexpr (!kNextFit)
+      return;
+
+    std::byte* prev = internal::AsBytePtr(rover_.prev);
+    std::byte* begin = internal::AsBytePtr(survivor);
+    if (rover_.block == owner && prev > begin &&
+        prev < begin + survivor->GetSize())
+      rover_.prev = survivor;
+  }
+
   std::reference_wrapper<Provider> provider_;
 
-  internal::BlockHeader* block_ = nullptr;
-  internal::BlockHeader* free_list_ = nullptr;
+  // Blocks fetched from |Provider|, chained through their descriptors.
+  BlockDescriptor* blocks_ = nullptr;
+
+  // Where the next search resumes from, for |FindBy::NextFit|.
+  Rover rover_;
+
+  // Free blocks of at least |kIndexThreshold| bytes across all blocks, by
+  // size. Unused unless |kIndexed|.
+  SizeIndex index_;
+
+  // Returned blocks of up to |kFastBinsMaxSize| bytes, kept out of the free
+  // lists, by size.
+  std::array<FastBin, kFastBinCount> fast_bins_ = {};
+
+  // Every byte of the head of |blocks_| from here on is known to be zero.
+  // Older blocks are assumed to have been written to throughout.
+  std::byte* untouched_ = nullptr;
 };
 
 } // namespace allocators::strategy
@@ -0,0 +1,112 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+
+#include <allocators/common/error.hpp>
+#include <allocators/common/trait.hpp>
+#include <allocators/internal/util.hpp>
+
+namespace allocators::strategy {
+
+// A small-buffer allocator. Requests are served from an inline buffer of |N|
+// bytes, stored within the object itself, by bumping an offset upward the same
+// way |LockFreeBump| does. Once the buffer can't fit a request, it's deferred
+// to |Fallback|. Declaring this object on the stack therefore keeps small,
+// short-lived allocations off the heap entirely.
+//
+// Returning a pointer from the inline buffer only reclaims its space if it's
+// the most recent allocation, e.g. a container that reallocates its storage;
+// otherwise, the space is reclaimed on |Reset|. Every other pointer is returned
+// to |Fallback|.
+//
+// |Fallback| is held by reference and must outlive this object. It's usually
+// shared with other code, so |Reset| leaves it alone, and pointers it served
+// stay live until returned to it or until its owner resets it. This allocator
+// is not thread-safe.
+template <std::size_t N, class Fallback>
+requires StrategyTrait<Fallback>
+class InlineBuffer {
+public:
+  explicit InlineBuffer(Fallback& fallback) : fallback_(fallback) {}
+
+  ALLOCATORS_NO_COPY_NO_MOVE_NO_DEFAULT(InlineBuffer);
+
+  Result<std::byte*> Find(Layout layout) noexcept {
+    if (!IsValid(layout))
+      return cpp::fail(Error::InvalidInput);
+
+    auto base = reinterpret_cast<std::uintptr_t>(&buffer_[0]);
+    std::size_t offset =
+        internal::AlignUp(base + offset_, layout.alignment) - base;
+    // Aligning may push |offset| past the end of the buffer, and a huge size
+    // would wrap around if added to it.
+    if (offset <= N && layout.size <= N - offset) {
+      last_ = offset;
+      offset_ = offset + layout.size;
+      return &buffer_[offset];
+    }
+
+    return fallback_.get().Find(layout);
+  }
+
+  Result<std::byte*> Find(std::size_t size) noexcept {
+    return Find(Layout(size, internal::kMinimumAlignment));
+  }
+
+  Result<void> Return(std::byte* ptr) {
+    if (ptr == nullptr)
+      return cpp::fail(Error::InvalidInput);
+
+    if (!IsInline(ptr))
+      return fallback_.get().Return(ptr);
+
+    if (ptr == &buffer_[last_] && last_ < offset_)
+      offset_ = last_;
+
+    return {};
+  }
+
+  Result<void> Return(std::byte* ptr, Layout layout) {
+    if (ptr != nullptr && !IsInline(ptr))
+      return fallback_.get().Return(ptr, layout);
+
+    return Return(ptr);
+  }
+
+  // Reclaim the inline buffer. |Fallback| isn't reset.
+  Result<void> Reset() {
+    offset_ = last_ = 0;
+    return {};
+  }
+
+  bool Owns(std::byte* ptr) const requires OwnershipTrait<Fallback> {
+    return IsInline(ptr) || fallback_.get().Owns(ptr);
+  }
+
+  constexpr bool AcceptsAlignment() const { return true; }
+
+  constexpr bool AcceptsReturn() const {
+    return fallback_.get().AcceptsReturn();
+  }
+
+private:
+  bool IsInline(const std::byte* ptr) const {
+    return ptr >= &buffer_[0] && ptr < &buffer_[0] + N;
+  }
+
+  static_assert(N > 0, "N must be greater than 0.");
+
+  std::reference_wrapper<Fallback> fallback_;
+
+  // Offset of the next free byte in |buffer_|.
+  std::size_t offset_ = 0;
+
+  // Offset of the most recent allocation in |buffer_|.
+  std::size_t last_ = 0;
+
+  alignas(std::max_align_t) std::byte buffer_[N];
+};
+
+} // namespace allocators::strategy
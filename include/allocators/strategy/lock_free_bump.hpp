@@ -2,6 +2,7 @@
 
 #include <atomic>
 #include <functional>
+#include <span>
 
 #include <template/parameters.hpp>
 
@@ -61,7 +62,7 @@ public:
         continue;
       }
 
-      std::size_t headroom = provider_.get().GetBlockSize() - old_active.size;
+      std::size_t headroom = provider_.get().GetBlockSize() - old_active.offset;
       if (headroom < request_size) {
         if (auto result = AllocateNewBlock(); result.has_error())
           return cpp::fail(result.error());
@@ -70,6 +71,7 @@ public:
       }
 
       BlockDescriptor new_active = old_active;
+      new_active.last = old_active.offset;
       new_active.offset = old_active.offset + request_size;
       if (active_.compare_exchange_weak(old_active, new_active))
         return block_table_[old_active.index] + old_active.offset;
@@ -85,6 +87,83 @@ public:
     return cpp::fail(Error::OperationNotSupported);
   }
 
+  Result<void> Return(std::byte* ptr, Layout layout) { return Return(ptr); }
+
+  // Fill |out| with allocations of |layout|, all carved out of the active
+  // block in a single atomic update. The allocations are neighbors to each
+  // other, in the order they appear in |out|.
+  Result<void> FindBatch(Layout layout, std::span<std::byte*> out) noexcept {
+    if (!IsValid(layout))
+      return cpp::fail(Error::InvalidInput);
+
+    if (out.empty())
+      return {};
+
+    std::size_t request_size = internal::AlignUp(layout.size, layout.alignment);
+    std::size_t batch_size = request_size * out.size();
+    if (batch_size / out.size() != request_size ||
+        batch_size > provider_.get().GetBlockSize())
+      return cpp::fail(Error::SizeRequestTooLarge);
+
+    while (true) {
+      BlockDescriptor old_active = active_.load();
+      if (!old_active.initialized ||
+          provider_.get().GetBlockSize() - old_active.offset < batch_size) {
+        if (auto result = AllocateNewBlock(); result.has_error())
+          return cpp::fail(result.error());
+
+        continue;
+      }
+
+      BlockDescriptor new_active = old_active;
+      new_active.last = old_active.offset + batch_size - request_size;
+      new_active.offset = old_active.offset + batch_size;
+      if (active_.compare_exchange_weak(old_active, new_active)) {
+        std::byte* base = block_table_[old_active.index] + old_active.offset;
+        for (std::size_t i = 0; i < out.size(); ++i)
+          out[i] = base + i * request_size;
+
+        return {};
+      }
+    }
+  }
+
+  Result<void> ReturnBatch(std::span<std::byte*> ptrs) {
+    // The bump allocator does not support per-object deallocation.
+    return cpp::fail(Error::OperationNotSupported);
+  }
+
+  // Resize the allocation at |ptr| in place. Only the most recent allocation
+  // can be resized, by moving the offset of the active block. Fails with
+  // |Error::NoFreeBlock| for any other allocation, or if the active block
+  // doesn't have enough headroom.
+  Result<void> Resize(std::byte* ptr, Layout layout) {
+    if (!IsValid(layout) || ptr == nullptr)
+      return cpp::fail(Error::InvalidInput);
+
+    if (reinterpret_cast<std::uintptr_t>(ptr) % layout.alignment != 0)
+      return cpp::fail(Error::NoFreeBlock);
+
+    std::size_t request_size = internal::AlignUp(layout.size, layout.alignment);
+
+    while (true) {
+      BlockDescriptor old_active = active_.load();
+      if (!old_active.initialized || old_active.offset == 0)
+        return cpp::fail(Error::NoFreeBlock);
+
+      if (ptr != block_table_[old_active.index] + old_active.last)
+        return cpp::fail(Error::NoFreeBlock);
+
+      if (old_active.last + request_size > provider_.get().GetBlockSize())
+        return cpp::fail(Error::NoFreeBlock);
+
+      BlockDescriptor new_active = old_active;
+      new_active.offset = old_active.last + request_size;
+      if (active_.compare_exchange_weak(old_active, new_active))
+        return {};
+    }
+  }
+
   Result<void> Reset() {
     auto old_active = active_.load();
     if (!old_active.initialized)
@@ -103,6 +182,21 @@ public:
     return {};
   }
 
+  bool Owns(std::byte* ptr) const {
+    auto active = active_.load();
+    if (!active.initialized || ptr == nullptr)
+      return false;
+
+    std::size_t block_size = provider_.get().GetBlockSize();
+    for (auto i = 0u; i <= active.index; i++) {
+      std::byte* block = block_table_[i];
+      if (block != nullptr && ptr >= block && ptr < block + block_size)
+        return true;
+    }
+
+    return false;
+  }
+
   constexpr bool AcceptsAlignment() const { return true; }
 
   constexpr bool AcceptsReturn() const { return false; }
@@ -123,21 +217,21 @@ private:
     // Index in |block_table_|.
     std::uint64_t index : kTotalEntryInBits;
 
-    // Multiples of 4KB. Supports block size of ~262MB.
-    std::uint64_t size : 16;
+    // Offset within block of the most recent allocation. Only this
+    // allocation can be resized.
+    std::uint64_t last : 25;
 
     // Current offset within block. Next allocation will return pointer
-    // based off this position.
-    // We need 25 bits below because size can scale up to ~262MB: log2(4KB * 16)
-    // = ~25
+    // based off this position. 25 bits supports blocks of up to 32MB.
     std::uint64_t offset : 25;
 
-    std::uint64_t _unused : 2;
+    std::uint64_t _unused : 3;
   };
 
   Result<void> AllocateNewBlock() {
     auto old_active = active_.load();
     auto new_active = old_active;
+    new_active.last = 0;
     new_active.offset = 0;
     if (old_active.initialized)
       new_active.index = old_active.index + 1;
@@ -0,0 +1,321 @@
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <strings.h>
+
+#include <template/parameters.hpp>
+
+#include <allocators/common/error.hpp>
+#include <allocators/common/trait.hpp>
+#include <allocators/internal/util.hpp>
+
+namespace allocators::strategy {
+
+// Parameters for Ring class defined below.
+struct RingParams {
+  // Which threads are allowed to call |Find| and |Return| concurrently.
+  enum Producers {
+    // One thread calls |Find| while another calls |Return|.
+    Single = 0,
+
+    // Any number of threads call |Find| and |Return|.
+    Multiple = 1
+  };
+
+  template <Producers P>
+  struct ProducersT : std::integral_constant<Producers, P> {};
+
+  // Number of blocks requested from the provider, in a single |Provide| call,
+  // to back the ring. Defaults to 1.
+  template <std::size_t Count>
+  struct CountT : std::integral_constant<std::size_t, Count> {};
+};
+
+// A circular allocator. This allocator requests a single, fixed span of memory
+// from |Provider| on first allocation, and moves a head offset through it,
+// wrapping around at the end. Returned allocations are marked as released, and
+// the tail offset moves past them once every older allocation has been
+// released as well. Allocations are therefore expected to be returned in
+// roughly the same order they were made. An allocation returned out of order
+// holds onto its space until everything older than it has been returned.
+//
+// Both allocation and reclamation are constant time, and consecutive
+// allocations are laid out next to each other in memory. This allocator is
+// most appropriate for messages passed through queues, where objects live
+// for roughly the same amount of time.
+//
+// Each allocation is preceded by a 16-byte header. The header is tagged with
+// the allocation's position in the ring so that stale headers, left behind by
+// a previous pass over the same memory, are never mistaken for live ones.
+//
+// Blocks from |Provider| must be aligned to at least 16 bytes.
+//
+// The thread-safety of this allocator is determined by |ProducersT|.
+// By default, only a single thread may call |Find| and a single thread may
+// call |Return|.
+template <class Provider, class... Args>
+requires ProviderTrait<Provider>
+class Ring : public RingParams {
+public:
+  static constexpr Producers kProducers =
+      ntp::optional<ProducersT<Producers::Single>, Args...>::value;
+
+  static constexpr std::size_t kCount =
+      std::max({std::size_t(1), ntp::optional<CountT<1>, Args...>::value});
+
+  explicit Ring(Provider& provider) : provider_(provider) {}
+
+  ALLOCATORS_NO_COPY_NO_MOVE_NO_DEFAULT(Ring);
+
+  // TODO: Don't ignore this error.
+  ~Ring() { (void)Reset(); }
+
+  Result<std::byte*> Find(Layout layout) noexcept {
+    if (!IsValid(layout))
+      return cpp::fail(Error::InvalidInput);
+
+    std::size_t body_size = internal::AlignUp(layout.size, kHeaderSize);
+    if (internal::AlignUp(kHeaderSize, layout.alignment) + body_size >
+        GetCapacity())
+      return cpp::fail(Error::SizeRequestTooLarge);
+
+    auto base_or = GetSpan();
+    if (base_or.has_error())
+      return cpp::fail(base_or.error());
+
+    std::byte* base = base_or.value();
+    while (true) {
+      std::uint64_t head = head_.load(std::memory_order_relaxed);
+      std::uint64_t tail = tail_.load(std::memory_order_acquire);
+      // Other producers allocated and released records since |head| was
+      // loaded, moving the tail past it. The check for free space below would
+      // wrap around on such a stale head.
+      if (tail > head)
+        continue;
+
+      auto reservation_or = Reserve(base, head, layout.alignment, body_size);
+      if (reservation_or.has_error())
+        return cpp::fail(reservation_or.error());
+
+      Reservation reservation = reservation_or.value();
+      if (reservation.end - tail > GetCapacity())
+        return cpp::fail(Error::NoFreeBlock);
+
+      if constexpr (kProducers == Producers::Single) {
+        head_.store(reservation.end, std::memory_order_release);
+      } else if (!head_.compare_exchange_weak(head, reservation.end,
+                                              std::memory_order_acq_rel)) {
+        continue;
+      }
+
+      // Space between the old head and the new header is either padding
+      // needed for alignment or the remainder of the ring prior to wrapping
+      // around. Either way, it's written out as already released so that the
+      // tail moves past it.
+      if (reservation.wrap > head)
+        WriteHeader(base, head, reservation.wrap - head, kReleased);
+      std::uint64_t start = std::max(head, reservation.wrap);
+      if (reservation.header > start)
+        WriteHeader(base, start, reservation.header - start, kReleased);
+
+      WriteHeader(base, reservation.header,
+                  reservation.end - reservation.header, 0);
+      return At(base, reservation.header) + kHeaderSize;
+    }
+  }
+
+  Result<std::byte*> Find(std::size_t size) noexcept {
+    return Find(Layout(size, internal::kMinimumAlignment));
+  }
+
+  Result<void> Return(std::byte* ptr) {
+    std::byte* base = base_.load(std::memory_order_acquire);
+    if (ptr == nullptr || base == nullptr)
+      return cpp::fail(Error::InvalidInput);
+
+    if (ptr < base + kHeaderSize || ptr >= base + GetCapacity())
+      return cpp::fail(Error::InvalidInput);
+
+    auto* header = reinterpret_cast<Header*>(ptr - kHeaderSize);
+    std::atomic_ref<std::uint64_t> tag(header->tag);
+    std::uint64_t value = tag.load(std::memory_order_acquire);
+    if (value & kReleased)
+      return cpp::fail(Error::InvalidInput);
+
+    tag.store(value | kReleased, std::memory_order_release);
+    Reclaim(base);
+    return {};
+  }
+
+  Result<void> Return(std::byte* ptr, Layout layout) { return Return(ptr); }
+
+  // Discard all allocations and release the span back to |Provider|.
+  // This method isn't thread-safe.
+  Result<void> Reset() {
+    std::byte* base = base_.load();
+    if (base == nullptr)
+      return {};
+
+    if (auto result = provider_.get().Return(base); result.has_error())
+      return cpp::fail(result.error());
+
+    base_.store(nullptr);
+    head_.store(0);
+    tail_.store(0);
+    return {};
+  }
+
+  bool Owns(std::byte* ptr) const {
+    std::byte* base = base_.load(std::memory_order_acquire);
+    return base != nullptr && ptr >= base && ptr < base + GetCapacity();
+  }
+
+  constexpr bool AcceptsAlignment() const { return true; }
+
+  constexpr bool AcceptsReturn() const { return true; }
+
+private:
+  // Placed before every allocation, and at the start of any padding.
+  struct Header {
+    // Size of the record, including this header.
+    std::uint64_t size;
+
+    // Position of this header in the ring, shifted left by one. The lowest
+    // bit is set once the record is released.
+    std::uint64_t tag;
+  };
+
+  static constexpr std::size_t kHeaderSize = sizeof(Header);
+
+  static constexpr std::uint64_t kReleased = 1;
+
+  // Positions, in monotonically increasing offsets, of a reserved record.
+  struct Reservation {
+    // Position where the ring wraps around. Equal to the old head if the
+    // record doesn't wrap.
+    std::uint64_t wrap;
+
+    // Position of the header for the record.
+    std::uint64_t header;
+
+    // Position after the end of the record. This is the new head.
+    std::uint64_t end;
+  };
+
+  // Usable size of the span. Records are kept at multiples of |kHeaderSize|
+  // so that padding is always large enough to hold a header.
+  std::size_t GetCapacity() const {
+    return internal::AlignDown(kCount * provider_.get().GetBlockSize(),
+                               kHeaderSize);
+  }
+
+  std::byte* At(std::byte* base, std::uint64_t position) {
+    return base + position % GetCapacity();
+  }
+
+  void WriteHeader(std::byte* base, std::uint64_t position, std::uint64_t size,
+                   std::uint64_t flags) {
+    auto* header = reinterpret_cast<Header*>(At(base, position));
+    std::atomic_ref<std::uint64_t>(header->size)
+        .store(size, std::memory_order_relaxed);
+    std::atomic_ref<std::uint64_t>(header->tag)
+        .store(position << 1 | flags, std::memory_order_release);
+  }
+
+  // Determine where a record of |body_size| bytes, aligned to |alignment|,
+  // goes if placed at |head|.
+  Result<Reservation> Reserve(std::byte* base, std::uint64_t head,
+                              std::size_t alignment, std::size_t body_size) {
+    auto address = reinterpret_cast<std::uintptr_t>(base);
+    std::uint64_t offset = head % GetCapacity();
+    std::uint64_t wrap = head;
+
+    std::uint64_t data =
+        internal::AlignUp(address + offset + kHeaderSize, alignment) - address;
+    if (data + body_size > GetCapacity()) {
+      wrap = head + (GetCapacity() - offset);
+      offset = 0;
+      data = internal::AlignUp(address + kHeaderSize, alignment) - address;
+      // The span itself isn't aligned to |alignment|.
+      if (data + body_size > GetCapacity())
+        return cpp::fail(Error::SizeRequestTooLarge);
+    }
+
+    std::uint64_t header = wrap + (data - kHeaderSize - offset);
+    return Reservation{.wrap = wrap,
+                       .header = header,
+                       .end = header + kHeaderSize + body_size};
+  }
+
+  // Move the tail past every released record at the end of the ring.
+  void Reclaim(std::byte* base) {
+    std::uint64_t tail = tail_.load(std::memory_order_acquire);
+    while (tail != head_.load(std::memory_order_acquire)) {
+      auto* header = reinterpret_cast<Header*>(At(base, tail));
+      std::uint64_t tag = std::atomic_ref<std::uint64_t>(header->tag)
+                              .load(std::memory_order_acquire);
+      if (tag != (tail << 1 | kReleased))
+        return;
+
+      std::uint64_t next =
+          tail + std::atomic_ref<std::uint64_t>(header->size)
+                     .load(std::memory_order_relaxed);
+      if constexpr (kProducers == Producers::Single) {
+        tail_.store(next, std::memory_order_release);
+        tail = next;
+      } else if (tail_.compare_exchange_weak(tail, next,
+                                             std::memory_order_acq_rel)) {
+        tail = next;
+      }
+    }
+  }
+
+  Result<std::byte*> GetSpan() {
+    std::byte* base = base_.load(std::memory_order_acquire);
+    if (base != nullptr)
+      return base;
+
+    auto new_base_or = provider_.get().Provide(kCount);
+    if (new_base_or.has_error())
+      return cpp::fail(new_base_or.error());
+
+    std::byte* new_base = new_base_or.value();
+    if (reinterpret_cast<std::uintptr_t>(new_base) % kHeaderSize != 0) {
+      (void)provider_.get().Return(new_base);
+      return cpp::fail(Error::Internal);
+    }
+
+    // The span may contain headers from prior use, e.g. when backed by
+    // |provider::Static|, that would otherwise be read as live records.
+    bzero(new_base, GetCapacity());
+
+    if (base_.compare_exchange_strong(base, new_base,
+                                      std::memory_order_acq_rel))
+      return new_base;
+
+    if (auto result = provider_.get().Return(new_base); result.has_error())
+      return cpp::fail(result.error());
+
+    return base;
+  }
+
+  static_assert(kHeaderSize % internal::kMinimumAlignment == 0,
+                "Header must preserve minimum alignment.");
+
+  // Backing allocator to used to acquire and release blocks.
+  std::reference_wrapper<Provider> provider_;
+
+  // Start of the span backing the ring.
+  std::atomic<std::byte*> base_ = nullptr;
+
+  // Monotonically increasing positions. The offset within the span is the
+  // position modulo |GetCapacity()|.
+  std::atomic<std::uint64_t> head_ = 0;
+  std::atomic<std::uint64_t> tail_ = 0;
+};
+
+} // namespace allocators::strategy
@@ -0,0 +1,78 @@
+#pragma once
+
+#include <cstddef>
+#include <functional>
+
+#include <allocators/common/error.hpp>
+#include <allocators/common/trait.hpp>
+#include <allocators/internal/util.hpp>
+
+namespace allocators::strategy {
+
+// A composite strategy that routes requests by size. Requests of at most
+// |Threshold| bytes are served by |Small|, every other request is served by
+// |Large|. Since the size of an allocation isn't known when it's returned
+// without a layout, |Small| must be able to tell whether it owns a pointer so
+// that |Return| is routed to the right strategy.
+//
+// Both strategies are held by reference and must outlive this object. Their
+// lifetime is up to their owner, so |Reset| doesn't reset them. Routing is
+// resolved at compile-time, so no virtual dispatch is involved.
+//
+// This strategy is as thread-safe as |Small| and |Large| are.
+template <std::size_t Threshold, class Small, class Large>
+requires StrategyTrait<Small> && StrategyTrait<Large> && OwnershipTrait<Small>
+class Segregator {
+public:
+  Segregator(Small& small, Large& large) : small_(small), large_(large) {}
+
+  ALLOCATORS_NO_COPY_NO_MOVE_NO_DEFAULT(Segregator);
+
+  Result<std::byte*> Find(Layout layout) noexcept {
+    if (layout.size <= Threshold)
+      return small_.get().Find(layout);
+
+    return large_.get().Find(layout);
+  }
+
+  Result<std::byte*> Find(std::size_t size) noexcept {
+    return Find(Layout(size, internal::kMinimumAlignment));
+  }
+
+  Result<void> Return(std::byte* ptr) {
+    if (small_.get().Owns(ptr))
+      return small_.get().Return(ptr);
+
+    return large_.get().Return(ptr);
+  }
+
+  // Route by the size of |layout|, the same way |Find| does, without asking
+  // |Small| whether it owns |ptr|.
+  Result<void> Return(std::byte* ptr, Layout layout) {
+    if (layout.size <= Threshold)
+      return small_.get().Return(ptr, layout);
+
+    return large_.get().Return(ptr, layout);
+  }
+
+  // This object holds no state of its own, so there's nothing to reset.
+  Result<void> Reset() { return {}; }
+
+  bool Owns(std::byte* ptr) const requires OwnershipTrait<Large> {
+    return small_.get().Owns(ptr) || large_.get().Owns(ptr);
+  }
+
+  constexpr bool AcceptsAlignment() const {
+    return small_.get().AcceptsAlignment() && large_.get().AcceptsAlignment();
+  }
+
+  constexpr bool AcceptsReturn() const {
+    return small_.get().AcceptsReturn() && large_.get().AcceptsReturn();
+  }
+
+private:
+  std::reference_wrapper<Small> small_;
+  std::reference_wrapper<Large> large_;
+};
+
+} // namespace allocators::strategy
@@ -0,0 +1,256 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <limits>
+
+#include <allocators/common/error.hpp>
+#include <allocators/common/trait.hpp>
+#include <allocators/internal/util.hpp>
+
+namespace allocators::strategy {
+
+// A LIFO allocator. Like |LockFreeBump|, this allocator moves an offset upward
+// through blocks fetched from |Provider|. Unlike it, every allocation is
+// preceded by a compact frame recording the offsets of the prior allocation,
+// so that returning the most recent allocation pops it in O(1). Only the most
+// recent allocation may be returned; returning any other pointer fails with
+// |Error::InvalidInput|.
+//
+// When a pop empties a block that isn't the first one, the allocator steps
+// back to the prior block and caches the empty one for the next time the
+// stack grows past the boundary. At most one block is cached, any other is
+// released to |Provider|.
+//
+// This allocator is most appropriate for recursive algorithms and scoped
+// temporaries where objects are released in the reverse order they were
+// created.
+//
+// This allocator is not thread-safe.
+template <class Provider, class... Args>
+requires ProviderTrait<Provider>
+class Stack {
+public:
+  explicit Stack(Provider& provider) : provider_(provider) {}
+
+  ALLOCATORS_NO_COPY_NO_MOVE_NO_DEFAULT(Stack);
+
+  // TODO: Don't ignore this error.
+  ~Stack() { (void)Reset(); }
+
+  Result<std::byte*> Find(Layout layout) noexcept {
+    if (!IsValid(layout))
+      return cpp::fail(Error::InvalidInput);
+
+    std::size_t block_size = provider_.get().GetBlockSize();
+    if (block_size > kMaxBlockSize)
+      return cpp::fail(Error::OperationNotSupported);
+
+    if (internal::AlignUp(kOverhead, layout.alignment) + layout.size >
+        block_size)
+      return cpp::fail(Error::SizeRequestTooLarge);
+
+    if (top_) {
+      if (auto ptr = Push(top_, layout); ptr != nullptr)
+        return ptr;
+    }
+
+    auto block_or = AcquireBlock();
+    if (block_or.has_error())
+      return cpp::fail(block_or.error());
+
+    Block* block = block_or.value();
+    std::byte* ptr = Push(block, layout);
+    // The block may not be aligned to |layout.alignment|, in which case even
+    // an empty block can't fit the request.
+    if (ptr == nullptr) {
+      if (auto result = CacheBlock(block); result.has_error())
+        return cpp::fail(result.error());
+
+      return cpp::fail(Error::SizeRequestTooLarge);
+    }
+
+    block->prev = top_;
+    top_ = block;
+    return ptr;
+  }
+
+  Result<std::byte*> Find(std::size_t size) noexcept {
+    return Find(Layout(size, internal::kMinimumAlignment));
+  }
+
+  Result<void> Return(std::byte* ptr) {
+    if (ptr == nullptr || top_ == nullptr || top_->last == 0)
+      return cpp::fail(Error::InvalidInput);
+
+    // Only the most recent allocation can be popped.
+    if (ptr != GetBase(top_) + top_->last)
+      return cpp::fail(Error::InvalidInput);
+
+    auto* frame = reinterpret_cast<Frame*>(ptr - sizeof(Frame));
+    top_->top = frame->prev_top;
+    top_->last = frame->prev_last;
+
+    if (top_->last == 0 && top_->prev != nullptr) {
+      Block* empty = top_;
+      top_ = top_->prev;
+      if (auto result = CacheBlock(empty); result.has_error())
+        return cpp::fail(result.error());
+    }
+
+    return {};
+  }
+
+  Result<void> Return(std::byte* ptr, Layout layout) { return Return(ptr); }
+
+  // Resize the most recent allocation in place. Fails with
+  // |Error::NoFreeBlock| for any other allocation, or if the block on top of
+  // the stack can't fit the new size.
+  Result<void> Resize(std::byte* ptr, Layout layout) {
+    if (!IsValid(layout) || ptr == nullptr)
+      return cpp::fail(Error::InvalidInput);
+
+    if (top_ == nullptr || top_->last == 0 ||
+        ptr != GetBase(top_) + top_->last)
+      return cpp::fail(Error::NoFreeBlock);
+
+    if (reinterpret_cast<std::uintptr_t>(ptr) % layout.alignment != 0 ||
+        top_->last + layout.size > provider_.get().GetBlockSize())
+      return cpp::fail(Error::NoFreeBlock);
+
+    top_->top = static_cast<std::uint32_t>(top_->last + layout.size);
+    return {};
+  }
+
+  Result<void> Reset() {
+    while (top_ != nullptr) {
+      Block* prev = top_->prev;
+      if (auto result = provider_.get().Return(GetBase(top_));
+          result.has_error())
+        return cpp::fail(result.error());
+
+      top_ = prev;
+    }
+
+    if (cached_ != nullptr) {
+      if (auto result = provider_.get().Return(GetBase(cached_));
+          result.has_error())
+        return cpp::fail(result.error());
+
+      cached_ = nullptr;
+    }
+
+    return {};
+  }
+
+  bool Owns(std::byte* ptr) const {
+    std::size_t block_size = provider_.get().GetBlockSize();
+    for (Block* itr = top_; itr != nullptr; itr = itr->prev)
+      if (ptr >= GetBase(itr) && ptr < GetBase(itr) + block_size)
+        return true;
+
+    return false;
+  }
+
+  constexpr bool AcceptsAlignment() const { return true; }
+
+  constexpr bool AcceptsReturn() const { return true; }
+
+private:
+  // Offsets are stored as 32-bit values, so blocks larger than this aren't
+  // supported.
+  static constexpr std::size_t kMaxBlockSize =
+      std::numeric_limits<std::uint32_t>::max();
+
+  // Metadata placed at the start of every block fetched from |Provider|.
+  struct Block {
+    // Block that was on top of the stack before this one.
+    Block* prev;
+
+    // Offset from the start of the block to the first free byte.
+    std::uint32_t top;
+
+    // Offset from the start of the block to the most recent allocation. 0 if
+    // there are no allocations in this block.
+    std::uint32_t last;
+  };
+
+  // Metadata placed immediately before every allocation. It records the state
+  // of the block prior to the allocation so that it can be restored on pop.
+  struct Frame {
+    std::uint32_t prev_top;
+    std::uint32_t prev_last;
+  };
+
+  static constexpr std::size_t kOverhead = sizeof(Block) + sizeof(Frame);
+
+  static std::byte* GetBase(Block* block) {
+    return reinterpret_cast<std::byte*>(block);
+  }
+
+  // Place |layout| on top of |block|. Returns nullptr if it doesn't fit.
+  std::byte* Push(Block* block, Layout layout) {
+    std::uintptr_t base = reinterpret_cast<std::uintptr_t>(block);
+    std::size_t offset =
+        internal::AlignUp(base + block->top + sizeof(Frame), layout.alignment) -
+        base;
+
+    if (offset + layout.size > provider_.get().GetBlockSize())
+      return nullptr;
+
+    std::byte* ptr = GetBase(block) + offset;
+    auto* frame = reinterpret_cast<Frame*>(ptr - sizeof(Frame));
+    frame->prev_top = block->top;
+    frame->prev_last = block->last;
+
+    block->top = static_cast<std::uint32_t>(offset + layout.size);
+    block->last = static_cast<std::uint32_t>(offset);
+    return ptr;
+  }
+
+  Result<Block*> AcquireBlock() {
+    Block* block = cached_;
+    if (block != nullptr) {
+      cached_ = nullptr;
+    } else {
+      auto base_or = provider_.get().Provide(1);
+      if (base_or.has_error())
+        return cpp::fail(base_or.error());
+
+      block = reinterpret_cast<Block*>(base_or.value());
+    }
+
+    block->prev = nullptr;
+    block->top = sizeof(Block);
+    block->last = 0;
+    return block;
+  }
+
+  // Keep |block| around for the next time the stack grows. If a block is
+  // already cached, |block| is released instead.
+  Result<void> CacheBlock(Block* block) {
+    if (cached_ == nullptr) {
+      cached_ = block;
+      return {};
+    }
+
+    if (auto result = provider_.get().Return(GetBase(block));
+        result.has_error())
+      return cpp::fail(result.error());
+
+    return {};
+  }
+
+  // Backing allocator to used to acquire and release blocks.
+  std::reference_wrapper<Provider> provider_;
+
+  // Block on top of the stack. Blocks are chained through |Block::prev|.
+  Block* top_ = nullptr;
+
+  // Empty block kept to avoid thrashing when the stack oscillates around a
+  // block boundary.
+  Block* cached_ = nullptr;
+};
+
+} // namespace allocators::strategy
@@ -0,0 +1,510 @@
+// Drop-in replacement for the C allocation functions and the global C++
+// allocation operators, backed by the allocators in this library. The shared
+// library built from this file can be injected into any dynamically linked
+// program, e.g.:
+//
+//   LD_PRELOAD=liballocators_malloc.so ./program
+//
+// Every thread is handed an arena, a |strategy::FreeList| fed by large chunks
+// of pages, on its first allocation. Arenas are locked on every call, so that
+// memory may be freed from any thread, but threads rarely contend for the same
+// arena. When a thread exits, its arena is orphaned and later adopted by the
+// next thread in need of one. Requests too large for an arena are mapped
+// directly from the OS.
+
+#include <cerrno>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <mutex>
+#include <new>
+#include <pthread.h>
+#include <sys/mman.h>
+
+#include <allocators/common/error.hpp>
+#include <allocators/internal/platform.hpp>
+#include <allocators/internal/util.hpp>
+#include <allocators/strategy/freelist.hpp>
+
+namespace {
+
+using namespace allocators;
+
+// Alignment guaranteed by |malloc|, matching |alignof(std::max_align_t)|.
+constexpr std::size_t kAlignment = 16;
+
+// Number of pages in each chunk handed to an arena.
+constexpr std::size_t kChunkPages = 256;
+
+// Largest request, in bytes, served by an arena. Anything larger is mapped
+// directly.
+constexpr std::size_t kMaxArenaRequest = 256 * 1024;
+
+// Provider for arenas. Every block is a chunk of |kChunkPages| pages.
+class ChunkProvider {
+public:
+  ChunkProvider() = default;
+
+  ALLOCATORS_NO_COPY_NO_MOVE(ChunkProvider);
+
+  Result<std::byte*> Provide(std::size_t count) {
+    if (count == 0 ||
+        count * kChunkPages > internal::VirtualAddressRange::kMaxPageCount)
+      return cpp::fail(Error::InvalidInput);
+
+    auto va_range_or = internal::FetchPages(count * kChunkPages);
+    if (va_range_or.has_error())
+      return cpp::fail(Error::OutOfMemory);
+
+    return internal::ToBytePtr(va_range_or.value().address);
+  }
+
+  Result<void> Return(std::byte* bytes) {
+    if (bytes == nullptr)
+      return cpp::fail(Error::InvalidInput);
+
+    auto va_range = internal::VirtualAddressRange{
+        .address = internal::FromBytePtr<std::uint64_t>(bytes),
+        .count = kChunkPages};
+    if (auto result = internal::ReturnPages(va_range); result.has_error())
+      return cpp::fail(Error::Internal);
+
+    return {};
+  }
+
+  static constexpr std::size_t GetBlockSize() {
+    return kChunkPages * internal::GetPageSize();
+  }
+
+  // Chunks are mapped on demand, so they're always zero-filled.
+  static constexpr bool kProvidesZeroedBlocks = true;
+};
+
+using Heap = strategy::FreeList<
+    ChunkProvider,
+    strategy::FreeListParams::SearchT<strategy::FreeListParams::FirstFit>,
+    strategy::FreeListParams::FastBinsT<256>,
+    strategy::FreeListParams::RetainedBlocksT<1>>;
+
+struct Arena {
+  Arena() : heap(provider) {}
+
+  ALLOCATORS_NO_COPY_NO_MOVE(Arena);
+
+  std::mutex mutex;
+  ChunkProvider provider;
+  Heap heap;
+
+  // Next arena in |arenas|.
+  Arena* next = nullptr;
+
+  // Set once the thread using this arena exits.
+  bool orphaned = false;
+};
+
+// Placed immediately before every pointer handed out.
+struct alignas(kAlignment) Header {
+  // Arena the allocation came from, or nullptr if it was mapped directly.
+  Arena* arena;
+
+  // Distance from the start of the underlying allocation to the pointer
+  // handed out.
+  std::uint32_t offset;
+
+  // Usable size in bytes for arena allocations. For direct mappings, the
+  // number of pages mapped.
+  std::uint32_t size;
+};
+
+static_assert(sizeof(Header) == kAlignment);
+
+// Every arena ever created. Arenas are never destroyed, only orphaned.
+Arena* arenas = nullptr;
+std::mutex arenas_mutex;
+
+pthread_key_t arena_key;
+bool arena_key_created = false;
+
+// Arena for the calling thread. The initial-exec model guarantees that
+// accessing the variable never allocates.
+thread_local Arena* tls_arena __attribute__((tls_model("initial-exec"))) =
+    nullptr;
+
+Header* GetHeader(void* ptr) {
+  return reinterpret_cast<Header*>(static_cast<std::byte*>(ptr) -
+                                   sizeof(Header));
+}
+
+void OrphanArena(void* arena) {
+  std::lock_guard lock(arenas_mutex);
+  static_cast<Arena*>(arena)->orphaned = true;
+}
+
+// Adopt an orphaned arena, or create a new one, for the calling thread.
+Arena* AcquireArena() {
+  Arena* arena = nullptr;
+  {
+    std::lock_guard lock(arenas_mutex);
+    if (!arena_key_created)
+      arena_key_created = pthread_key_create(&arena_key, &OrphanArena) == 0;
+
+    for (Arena* itr = arenas; itr != nullptr; itr = itr->next) {
+      if (itr->orphaned) {
+        itr->orphaned = false;
+        arena = itr;
+        break;
+      }
+    }
+
+    if (arena == nullptr) {
+      auto va_range_or = internal::FetchPages(
+          internal::AlignUp(sizeof(Arena), internal::GetPageSize()) /
+          internal::GetPageSize());
+      if (va_range_or.has_error())
+        return nullptr;
+
+      arena = new (reinterpret_cast<void*>(va_range_or.value().address)) Arena;
+      arena->next = arenas;
+      arenas = arena;
+    }
+  }
+
+  // Set before registering the key, which may itself allocate.
+  tls_arena = arena;
+  if (arena_key_created)
+    pthread_setspecific(arena_key, arena);
+
+  return arena;
+}
+
+// Map |size| bytes aligned to |alignment|. Mappings are only page-aligned, so
+// larger alignments are met by mapping |alignment| extra bytes and aligning
+// the pointer within them.
+void* AllocateMapped(std::size_t size, std::size_t alignment) {
+  std::size_t page_size = internal::GetPageSize();
+  if (sizeof(Header) + alignment > UINT32_MAX)
+    return nullptr;
+
+  std::size_t padding = sizeof(Header) + alignment;
+  if (size > SIZE_MAX - padding - page_size)
+    return nullptr;
+
+  std::size_t pages = internal::AlignUp(size + padding, page_size) / page_size;
+  if (pages > UINT32_MAX)
+    return nullptr;
+
+  void* base = mmap(nullptr, pages * page_size, PROT_READ | PROT_WRITE,
+                    MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+  if (base == MAP_FAILED)
+    return nullptr;
+
+  auto address = internal::AlignUp(
+      reinterpret_cast<std::uintptr_t>(base) + sizeof(Header), alignment);
+  auto* ptr = reinterpret_cast<std::byte*>(address);
+  *GetHeader(ptr) = Header{
+      .arena = nullptr,
+      .offset = static_cast<std::uint32_t>(ptr - static_cast<std::byte*>(base)),
+      .size = static_cast<std::uint32_t>(pages)};
+  return ptr;
+}
+
+// Allocate |size| bytes aligned to |alignment|. With |zeroed| set, the bytes
+// are cleared, like |calloc| does.
+void* Allocate(std::size_t size, std::size_t alignment = kAlignment,
+               bool zeroed = false) {
+  if (size == 0)
+    size = 1;
+
+  if (alignment < kAlignment)
+    alignment = kAlignment;
+
+  // Alignments that are a sizable fraction of a chunk waste most of it.
+  if (size > kMaxArenaRequest || alignment > internal::GetPageSize())
+    return AllocateMapped(size, alignment);
+
+  Arena* arena = tls_arena;
+  if (arena == nullptr && (arena = AcquireArena()) == nullptr)
+    return nullptr;
+
+  // The heap aligns |base| to |alignment|, and the header takes up the
+  // |alignment| bytes in front of the pointer, which are at least as many as
+  // it needs.
+  size = internal::AlignUp(size, kAlignment);
+  std::size_t offset = alignment;
+
+  std::byte* base;
+  {
+    std::lock_guard lock(arena->mutex);
+    auto layout = Layout(offset + size, alignment);
+    auto base_or =
+        zeroed ? arena->heap.FindZeroed(layout) : arena->heap.Find(layout);
+    if (base_or.has_error())
+      return nullptr;
+
+    base = base_or.value();
+  }
+
+  auto* ptr = base + offset;
+  *GetHeader(ptr) = Header{.arena = arena,
+                           .offset = static_cast<std::uint32_t>(offset),
+                           .size = static_cast<std::uint32_t>(size)};
+  return ptr;
+}
+
+void Release(void* ptr) {
+  if (ptr == nullptr)
+    return;
+
+  Header header = *GetHeader(ptr);
+  std::byte* base = static_cast<std::byte*>(ptr) - header.offset;
+  if (header.arena == nullptr) {
+    munmap(base, header.size * internal::GetPageSize());
+    return;
+  }
+
+  std::lock_guard lock(header.arena->mutex);
+  (void)header.arena->heap.Return(base);
+}
+
+// Grow or shrink an arena allocation without moving it.
+bool ResizeInPlace(void* ptr, std::size_t size) {
+  Header* header = GetHeader(ptr);
+  if (header->arena == nullptr || size > kMaxArenaRequest)
+    return false;
+
+  size = internal::AlignUp(size, kAlignment);
+  std::byte* base = static_cast<std::byte*>(ptr) - header->offset;
+  {
+    std::lock_guard lock(header->arena->mutex);
+    if (auto result = header->arena->heap.Resize(
+            base, Layout(header->offset + size, internal::kMinimumAlignment));
+        result.has_error())
+      return false;
+  }
+
+  header->size = static_cast<std::uint32_t>(size);
+  return true;
+}
+
+std::size_t GetUsableSize(void* ptr) {
+  if (ptr == nullptr)
+    return 0;
+
+  Header* header = GetHeader(ptr);
+  if (header->arena != nullptr)
+    return header->size;
+
+  return header->size * internal::GetPageSize() - header->offset;
+}
+
+void* AllocateOrSetErrno(std::size_t size, std::size_t alignment = kAlignment,
+                         bool zeroed = false) {
+  void* ptr = Allocate(size, alignment, zeroed);
+  if (ptr == nullptr)
+    errno = ENOMEM;
+
+  return ptr;
+}
+
+// Allocate on behalf of operator new, calling the new-handler until the
+// request succeeds.
+void* AllocateOrThrow(std::size_t size, std::size_t alignment = kAlignment) {
+  while (true) {
+    if (void* ptr = Allocate(size, alignment); ptr != nullptr)
+      return ptr;
+
+    std::new_handler handler = std::get_new_handler();
+    if (handler == nullptr)
+      throw std::bad_alloc();
+
+    handler();
+  }
+}
+
+void* AllocateOrNull(std::size_t size,
+                     std::size_t alignment = kAlignment) noexcept {
+  try {
+    return AllocateOrThrow(size, alignment);
+  } catch (...) {
+    return nullptr;
+  }
+}
+
+// Fork handlers. Every arena is locked across fork so that the child never
+// inherits a lock held by a thread that no longer exists. In the child, only
+// the forking thread survives, so every other arena is up for adoption.
+
+void PrepareFork() {
+  arenas_mutex.lock();
+  for (Arena* itr = arenas; itr != nullptr; itr = itr->next)
+    itr->mutex.lock();
+}
+
+void ResumeParent() {
+  for (Arena* itr = arenas; itr != nullptr; itr = itr->next)
+    itr->mutex.unlock();
+  arenas_mutex.unlock();
+}
+
+void ResumeChild() {
+  for (Arena* itr = arenas; itr != nullptr; itr = itr->next) {
+    itr->mutex.unlock();
+    itr->orphaned = itr != tls_arena;
+  }
+  arenas_mutex.unlock();
+}
+
+__attribute__((constructor)) void Initialize() {
+  pthread_atfork(&PrepareFork, &ResumeParent, &ResumeChild);
+}
+
+} // namespace
+
+extern "C" {
+
+void* malloc(std::size_t size) { return AllocateOrSetErrno(size); }
+
+void free(void* ptr) { Release(ptr); }
+
+void* calloc(std::size_t count, std::size_t size) {
+  std::size_t total;
+  if (__builtin_mul_overflow(count, size, &total)) {
+    errno = ENOMEM;
+    return nullptr;
+  }
+
+  // Direct mappings are already zeroed by the OS, and the heap skips parts of
+  // its chunks that were never written to.
+  return AllocateOrSetErrno(total, kAlignment, /*zeroed=*/true);
+}
+
+void* realloc(void* ptr, std::size_t size) {
+  if (ptr == nullptr)
+    return AllocateOrSetErrno(size);
+
+  if (size == 0) {
+    Release(ptr);
+    return nullptr;
+  }
+
+  if (ResizeInPlace(ptr, size))
+    return ptr;
+
+  std::size_t usable_size = GetUsableSize(ptr);
+  if (size <= usable_size)
+    return ptr;
+
+  void* new_ptr = AllocateOrSetErrno(size);
+  if (new_ptr == nullptr)
+    return nullptr;
+
+  std::memcpy(new_ptr, ptr, usable_size);
+  Release(ptr);
+  return new_ptr;
+}
+
+int posix_memalign(void** out, std::size_t alignment, std::size_t size) {
+  if (!internal::IsValidAlignment(alignment))
+    return EINVAL;
+
+  void* ptr = Allocate(size, alignment);
+  if (ptr == nullptr)
+    return ENOMEM;
+
+  *out = ptr;
+  return 0;
+}
+
+void* aligned_alloc(std::size_t alignment, std::size_t size) {
+  if (!internal::IsPowerOfTwo(alignment)) {
+    errno = EINVAL;
+    return nullptr;
+  }
+
+  return AllocateOrSetErrno(size, alignment);
+}
+
+void* memalign(std::size_t alignment, std::size_t size) {
+  return aligned_alloc(alignment, size);
+}
+
+void* valloc(std::size_t size) {
+  return AllocateOrSetErrno(size, internal::GetPageSize());
+}
+
+void* pvalloc(std::size_t size) {
+  return AllocateOrSetErrno(internal::AlignUp(size, internal::GetPageSize()),
+                            internal::GetPageSize());
+}
+
+std::size_t malloc_usable_size(void* ptr) { return GetUsableSize(ptr); }
+
+} // extern "C"
+
+void* operator new(std::size_t size) { return AllocateOrThrow(size); }
+
+void* operator new[](std::size_t size) { return AllocateOrThrow(size); }
+
+void* operator new(std::size_t size, const std::nothrow_t&) noexcept {
+  return AllocateOrNull(size);
+}
+
+void* operator new[](std::size_t size, const std::nothrow_t&) noexcept {
+  return AllocateOrNull(size);
+}
+
+void* operator new(std::size_t size, std::align_val_t alignment) {
+  return AllocateOrThrow(size, static_cast<std::size_t>(alignment));
+}
+
+void* operator new[](std::size_t size, std::align_val_t alignment) {
+  return AllocateOrThrow(size, static_cast<std::size_t>(alignment));
+}
+
+void* operator new(std::size_t size, std::align_val_t alignment,
+                   const std::nothrow_t&) noexcept {
+  return AllocateOrNull(size, static_cast<std::size_t>(alignment));
+}
+
+void* operator new[](std::size_t size, std::align_val_t alignment,
+                     const std::nothrow_t&) noexcept {
+  return AllocateOrNull(size, static_cast<std::size_t>(alignment));
+}
+
+void operator delete(void* ptr) noexcept { Release(ptr); }
+
+void operator delete[](void* ptr) noexcept { Release(ptr); }
+
+void operator delete(void* ptr, std::size_t) noexcept { Release(ptr); }
+
+void operator delete[](void* ptr, std::size_t) noexcept { Release(ptr); }
+
+void operator delete(void* ptr, const std::nothrow_t&) noexcept {
+  Release(ptr);
+}
+
+void operator delete[](void* ptr, const std::nothrow_t&) noexcept {
+  Release(ptr);
+}
+
+void operator delete(void* ptr, std::align_val_t) noexcept { Release(ptr); }
+
+void operator delete[](void* ptr, std::align_val_t) noexcept { Release(ptr); }
+
+void operator delete(void* ptr, std::size_t, std::align_val_t) noexcept {
+  Release(ptr);
+}
+
+void operator delete[](void* ptr, std::size_t, std::align_val_t) noexcept {
+  Release(ptr);
+}
+
+void operator delete(void* ptr, std::align_val_t,
+                     const std::nothrow_t&) noexcept {
+  Release(ptr);
+}
+
+void operator delete[](void* ptr, std::align_val_t,
+                       const std::nothrow_t&) noexcept {
+  Release(ptr);
+}
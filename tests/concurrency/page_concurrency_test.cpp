@@ -1,6 +1,10 @@
 #include "catch2/catch_all.hpp"
 
+#include <algorithm>
+#include <array>
+#include <atomic>
 #include <mutex>
+#include <span>
 #include <thread>
 #include <vector>
 
@@ -72,3 +76,198 @@ TEST_CASE("Page allocator works in multi-threaded contexts",
 
   REQUIRE(allocations.was_empty());
 }
+
+TEST_CASE("Page allocator works with batches in multi-threaded contexts",
+          "[concurrency][allocator][Page]") {
+  static constexpr std::size_t kMaximumOps = 100;
+  static constexpr std::size_t kBatchSize = 16;
+  static constexpr std::size_t kNumThreads = 32;
+
+  AllocatorUnderTest allocator;
+  std::atomic<std::size_t> failures = 0;
+
+  auto run = [&]() {
+    std::array<std::byte*, kBatchSize> batch;
+    for (std::size_t i = 0; i < kMaximumOps; ++i) {
+      if (allocator.ProvideBatch(batch).has_error()) {
+        ++failures;
+        continue;
+      }
+
+      // Pages must not be handed to two threads at once.
+      for (std::byte* p : batch)
+        *reinterpret_cast<std::thread::id*>(p) = std::this_thread::get_id();
+      for (std::byte* p : batch)
+        if (*reinterpret_cast<std::thread::id*>(p) !=
+            std::this_thread::get_id())
+          ++failures;
+
+      if (allocator.ReturnBatch(batch).has_error())
+        ++failures;
+    }
+  };
+
+  std::vector<std::thread> threads;
+  for (auto i = 0ul; i < kNumThreads; ++i)
+    threads.emplace_back(run);
+
+  for (auto& th : threads)
+    th.join();
+
+  REQUIRE(failures == 0);
+}
+
+TEST_CASE("Page allocator hands a page to one thread at a time",
+          "[concurrency][allocator][Page]") {
+  static constexpr std::size_t kMaximumOps = 1000;
+  static constexpr std::size_t kNumThreads = 64;
+
+  // Threads return pages right after taking them, so that many of them are
+  // handed over through the elimination array.
+  AllocatorUnderTest allocator;
+  std::atomic<std::size_t> failures = 0;
+
+  auto run = [&]() {
+    for (std::size_t i = 0; i < kMaximumOps; ++i) {
+      auto p_or = allocator.Provide(1);
+      if (p_or.has_error()) {
+        ++failures;
+        continue;
+      }
+
+      std::byte* p = p_or.value();
+      *reinterpret_cast<std::thread::id*>(p) = std::this_thread::get_id();
+      std::this_thread::yield();
+      if (*reinterpret_cast<std::thread::id*>(p) != std::this_thread::get_id())
+        ++failures;
+
+      if (allocator.Return(p).has_error())
+        ++failures;
+    }
+  };
+
+  std::vector<std::thread> threads;
+  for (auto i = 0ul; i < kNumThreads; ++i)
+    threads.emplace_back(run);
+
+  for (auto& th : threads)
+    th.join();
+
+  REQUIRE(failures == 0);
+}
+
+TEST_CASE("Page allocator grows in multi-threaded contexts",
+          "[concurrency][allocator][Page]") {
+  using Params = provider::LockFreePageParams;
+  static constexpr std::size_t kSuperBlockPages = 8;
+  static constexpr std::size_t kPagesPerThread = 32;
+  static constexpr std::size_t kNumThreads = 32;
+
+  // Every thread holds on to its pages, so that super blocks keep being
+  // attached while others are in use.
+  provider::LockFreePage<Params::LimitT<kNumThreads * kPagesPerThread>,
+                         Params::SuperBlockT<kSuperBlockPages>>
+      allocator;
+  std::atomic<std::size_t> failures = 0;
+
+  auto run = [&]() {
+    std::array<std::byte*, kPagesPerThread> pages;
+    for (std::byte*& p : pages) {
+      auto p_or = allocator.Provide(1);
+      if (p_or.has_error()) {
+        ++failures;
+        return;
+      }
+
+      p = p_or.value();
+      *reinterpret_cast<std::thread::id*>(p) = std::this_thread::get_id();
+    }
+
+    for (std::byte* p : pages)
+      if (*reinterpret_cast<std::thread::id*>(p) != std::this_thread::get_id())
+        ++failures;
+
+    if (allocator.ReturnBatch(pages).has_error())
+      ++failures;
+  };
+
+  std::vector<std::thread> threads;
+  for (auto i = 0ul; i < kNumThreads; ++i)
+    threads.emplace_back(run);
+
+  for (auto& th : threads)
+    th.join();
+
+  REQUIRE(failures == 0);
+}
+
+TEST_CASE("Page allocator serves pages while a super block is attached",
+          "[concurrency][allocator][Page]") {
+  using Params = provider::LockFreePageParams;
+  static constexpr std::size_t kSuperBlockPages = Params::kMaxSuperBlockPages;
+  static constexpr std::size_t kPagesPerThread = 64;
+  static constexpr std::size_t kNumThreads = 8;
+  static constexpr std::size_t kReturnedPages = kPagesPerThread * kNumThreads;
+
+  provider::LockFreePage<Params::LimitT<2 * kSuperBlockPages>,
+                         Params::SuperBlockT<kSuperBlockPages>>
+      allocator;
+
+  // Take every page of the first super block, then return just enough of them
+  // for every worker below, but not for the batch that forces a new super
+  // block to be attached.
+  std::vector<std::byte*> first(kSuperBlockPages);
+  REQUIRE(allocator.ProvideBatch(first).has_value());
+  REQUIRE(allocator.ReturnBatch(std::span(first).first(kReturnedPages))
+              .has_value());
+
+  std::atomic<bool> start = false;
+  std::atomic<std::size_t> failures = 0;
+
+  auto work = [&]() {
+    while (!start)
+      ;
+
+    std::array<std::byte*, kPagesPerThread> pages;
+    for (std::byte*& p : pages) {
+      auto p_or = allocator.Provide(1);
+      if (p_or.has_error()) {
+        ++failures;
+        return;
+      }
+
+      p = p_or.value();
+      *reinterpret_cast<std::thread::id*>(p) = std::this_thread::get_id();
+    }
+
+    for (std::byte* p : pages)
+      if (*reinterpret_cast<std::thread::id*>(p) != std::this_thread::get_id())
+        ++failures;
+  };
+
+  std::vector<std::byte*> attached(2 * kReturnedPages);
+  auto attach = [&]() {
+    while (!start)
+      ;
+
+    if (allocator.ProvideBatch(attached).has_error())
+      ++failures;
+  };
+
+  std::vector<std::thread> threads;
+  threads.emplace_back(attach);
+  for (auto i = 0ul; i < kNumThreads; ++i)
+    threads.emplace_back(work);
+
+  start = true;
+  for (auto& th : threads)
+    th.join();
+
+  REQUIRE(failures == 0);
+
+  // The first super block never had enough pages for the batch, so it must
+  // have come out of the new one.
+  auto [low, high] = std::minmax_element(first.begin(), first.end());
+  for (std::byte* p : attached)
+    REQUIRE((p < *low || p > *high));
+}
@@ -0,0 +1,133 @@
+#include "catch2/catch_all.hpp"
+
+#include <atomic>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+#include "atomic_queue/atomic_queue.h"
+
+#include <allocators/provider/lock_free_page.hpp>
+#include <allocators/provider/static.hpp>
+#include <allocators/strategy/ring.hpp>
+
+#include "../util.hpp"
+
+using namespace allocators;
+
+using AllocatorUnderTest = strategy::Ring<
+    provider::LockFreePage<>,
+    strategy::RingParams::ProducersT<strategy::RingParams::Producers::Multiple>,
+    strategy::RingParams::CountT<1>>;
+
+TEST_CASE("Ring allocator works in multi-threaded contexts",
+          "[concurrency][allocator][Ring]") {
+  static constexpr std::size_t kMaximumOps = 1000;
+  static constexpr std::size_t kNumThreads = 16;
+  static_assert(kNumThreads % 2 == 0, "number of threads must even");
+
+  provider::LockFreePage<> provider;
+  AllocatorUnderTest allocator(provider);
+  atomic_queue::AtomicQueue<std::byte*, 1024> allocations;
+  // Mutex used for calling Catch2's APIs
+  std::mutex catch_mutex;
+
+  auto allocate = [&]() {
+    for (std::size_t i = 0; i < kMaximumOps; ++i) {
+      auto p_or = allocator.Find(GetRandomNumber(1, 64));
+      // The ring is full. Wait for consumers to catch up.
+      while (p_or.has_error() && p_or.error() == Error::NoFreeBlock) {
+        std::this_thread::yield();
+        p_or = allocator.Find(GetRandomNumber(1, 64));
+      }
+
+      if (p_or.has_error()) {
+        std::scoped_lock lock(catch_mutex);
+        INFO("[" << std::this_thread::get_id()
+                 << "] Allocation failed: " << ToString(p_or.error()));
+        FAIL();
+      }
+
+      while (!allocations.try_push(p_or.value()))
+        ;
+    }
+  };
+
+  auto release = [&]() {
+    for (std::size_t i = 0; i < kMaximumOps; ++i) {
+      std::byte* p = nullptr;
+      while (!allocations.try_pop(p))
+        ;
+
+      auto result = allocator.Return(p);
+      if (result.has_error()) {
+        std::scoped_lock<std::mutex> lock(catch_mutex);
+        INFO("[" << std::this_thread::get_id()
+                 << "] Release failed: " << ToString(result.error()));
+        FAIL();
+      }
+    }
+  };
+
+  std::vector<std::thread> threads;
+  for (auto i = 0ul; i < kNumThreads; ++i) {
+    if (i % 2)
+      threads.emplace_back(allocate);
+    else
+      threads.emplace_back(release);
+  }
+
+  for (auto& th : threads)
+    th.join();
+
+  REQUIRE(allocations.was_empty());
+
+  // Everything was returned, so at least half of the span is available
+  // again no matter where the head ended up.
+  std::size_t request_size = provider.GetBlockSize() / 2 - 16;
+  REQUIRE(allocator.Find(request_size).has_value());
+}
+
+TEST_CASE("Ring allocator never runs out of space with a small live set",
+          "[concurrency][allocator][Ring]") {
+  static constexpr std::size_t kMaximumOps = 1000;
+  static constexpr std::size_t kNumThreads = 8;
+
+  // Large enough to hold every allocation made below without wrapping
+  // around, so running out of space can only be a bug.
+  static constexpr std::size_t kCapacity =
+      kNumThreads * kMaximumOps * (64 + 16) * 2;
+
+  using Provider = provider::Static<kCapacity>;
+  using Ring = strategy::Ring<
+      Provider, strategy::RingParams::ProducersT<
+                    strategy::RingParams::Producers::Multiple>>;
+
+  auto provider = std::make_unique<Provider>();
+  Ring allocator(*provider);
+
+  // Set up the span up front, so that threads don't race to do it.
+  REQUIRE(allocator.Return(GetValueOrFail(allocator.Find(1))).has_value());
+
+  std::atomic<std::size_t> failures = 0;
+
+  // Every allocation is returned right away, so that other threads keep
+  // moving both the head and the tail.
+  auto run = [&]() {
+    for (std::size_t i = 0; i < kMaximumOps; ++i) {
+      auto p_or = allocator.Find(GetRandomNumber(1, 64));
+      if (p_or.has_error() || allocator.Return(p_or.value()).has_error())
+        ++failures;
+    }
+  };
+
+  std::vector<std::thread> threads;
+  for (auto i = 0ul; i < kNumThreads; ++i)
+    threads.emplace_back(run);
+
+  for (auto& th : threads)
+    th.join();
+
+  REQUIRE(failures == 0);
+}
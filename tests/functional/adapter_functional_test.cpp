@@ -1,23 +1,110 @@
 #include "catch2/catch_all.hpp"
 
+#include <deque>
+#include <memory>
+#include <type_traits>
+#include <unordered_map>
 #include <vector>
 
 #include <allocators/adapter/adapter.hpp>
+#include <allocators/provider/lock_free_page.hpp>
 
 using namespace allocators;
 
 using T = long;
 
-TEST_CASE("BumpAdapter allocator works with standard containers",
-          "[functional][allocator][BumpAdapter]") {
-  SECTION("A fixed-sized allocator that can hold a page worth of objects") {
-    static constexpr std::size_t PageSize = 4096;
-    using AllocatorUnderTest = adapter::BumpAdapter<T, SizeT<PageSize>>;
+using Provider = provider::LockFreePage<>;
 
-    std::vector<T, AllocatorUnderTest> values;
-    for (size_t i = 0; i < 100; ++i)
+TEST_CASE("Adapter satisfies std::allocator_traits",
+          "[functional][allocator][Adapter]") {
+  using AllocatorUnderTest = adapter::FreeListAdapter<T, Provider>;
+  using Traits = std::allocator_traits<AllocatorUnderTest>;
+
+  static_assert(std::is_same_v<Traits::value_type, T>);
+  static_assert(std::is_same_v<Traits::rebind_alloc<int>,
+                               adapter::FreeListAdapter<int, Provider>>);
+  static_assert(Traits::propagate_on_container_copy_assignment::value);
+  static_assert(Traits::propagate_on_container_move_assignment::value);
+  static_assert(Traits::propagate_on_container_swap::value);
+  static_assert(!Traits::is_always_equal::value);
+
+  Provider provider;
+  strategy::FreeList<Provider> strategy_a(provider);
+  strategy::FreeList<Provider> strategy_b(provider);
+
+  AllocatorUnderTest a(strategy_a);
+  AllocatorUnderTest b(strategy_b);
+  Traits::rebind_alloc<int> rebound(a);
+
+  SECTION("Adapters are equal only if they share a strategy") {
+    REQUIRE(a == AllocatorUnderTest(a));
+    REQUIRE(a == rebound);
+    REQUIRE(a != b);
+  }
+
+  SECTION("Memory allocated by a rebound adapter can be deallocated") {
+    int* p = Traits::rebind_traits<int>::allocate(rebound, 4);
+    AllocatorUnderTest::rebind<int>::other(a).deallocate(p, 4);
+  }
+
+  SECTION("Failed allocations throw") {
+    REQUIRE_THROWS_AS(a.allocate(Provider::GetBlockSize()), std::bad_alloc);
+  }
+}
+
+TEST_CASE("Adapter allocator works with standard containers",
+          "[functional][allocator][Adapter]") {
+  Provider provider;
+
+  SECTION("std::vector over a FreeList") {
+    strategy::FreeList<Provider> strategy(provider);
+    using Allocator = adapter::FreeListAdapter<T, Provider>;
+    std::vector<T, Allocator> values{Allocator(strategy)};
+    for (T i = 0; i < 100; ++i)
       values.push_back(i);
 
-    SUCCEED(); // Should not panic here.
+    for (T i = 0; i < 100; ++i)
+      REQUIRE(values[i] == i);
+  }
+
+  SECTION("std::vector over a FreeList without allocation headers") {
+    using Params = strategy::FreeListParams;
+    using Strategy = strategy::FreeList<
+        Provider, Params::SizeTrackingT<Params::SizeTracking::ByCaller>>;
+    using Allocator = adapter::Adapter<T, Strategy>;
+
+    Strategy strategy(provider);
+    std::vector<T, Allocator> values{Allocator(strategy)};
+    for (T i = 0; i < 100; ++i)
+      values.push_back(i);
+
+    for (T i = 0; i < 100; ++i)
+      REQUIRE(values[i] == i);
+  }
+
+  SECTION("std::unordered_map over a LockFreeBump") {
+    using Strategy = strategy::LockFreeBump<Provider>;
+    using Allocator = adapter::Adapter<std::pair<const T, T>, Strategy>;
+
+    Strategy strategy(provider);
+    std::unordered_map<T, T, std::hash<T>, std::equal_to<T>, Allocator> values(
+        Allocator{strategy});
+    for (T i = 0; i < 100; ++i)
+      values[i] = i * 2;
+
+    for (T i = 0; i < 100; ++i)
+      REQUIRE(values.at(i) == i * 2);
+  }
+
+  SECTION("std::deque over a LockFreeBump") {
+    using Strategy = strategy::LockFreeBump<Provider>;
+    Strategy strategy(provider);
+    using Allocator = adapter::BumpAdapter<T, Provider>;
+    std::deque<T, Allocator> values{Allocator(strategy)};
+    for (T i = 0; i < 1000; ++i)
+      values.push_front(i);
+
+    REQUIRE(values.size() == 1000);
+    REQUIRE(values.front() == 999);
   }
 }
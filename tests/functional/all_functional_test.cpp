@@ -1,7 +1,14 @@
+#include <allocators/provider/from_strategy.hpp>
 #include <allocators/provider/lock_free_page.hpp>
 #include <allocators/provider/static.hpp>
+#include <allocators/strategy/bucketizer.hpp>
+#include <allocators/strategy/fallback.hpp>
 #include <allocators/strategy/freelist.hpp>
+#include <allocators/strategy/inline_buffer.hpp>
 #include <allocators/strategy/lock_free_bump.hpp>
+#include <allocators/strategy/ring.hpp>
+#include <allocators/strategy/segregator.hpp>
+#include <allocators/strategy/stack.hpp>
 
 // Compile test that ensure all classes can be compiled with all arguments
 // provided. This is necessary because template classes are not actually
@@ -17,3 +24,18 @@ using FreeList = allocators::strategy::FreeList<
     allocators::strategy::FreeListParams::SearchT<
         allocators::strategy::FreeListParams::FindBy::BestFit>>;
 using LockFreeBump = allocators::strategy::LockFreeBump<LockFreePage>;
+using Stack = allocators::strategy::Stack<LockFreePage>;
+using Ring = allocators::strategy::Ring<
+    LockFreePage,
+    allocators::strategy::RingParams::ProducersT<
+        allocators::strategy::RingParams::Producers::Multiple>,
+    allocators::strategy::RingParams::CountT<1>>;
+using Segregator = allocators::strategy::Segregator</*Threshold=*/64, Stack,
+                                                   LockFreeBump>;
+using Fallback = allocators::strategy::Fallback<Stack, Ring>;
+using Bucketizer =
+    allocators::strategy::Bucketizer<Stack, /*Min=*/0, /*Max=*/64, /*Step=*/16>;
+using FromStrategy = allocators::provider::FromStrategy<
+    FreeList, allocators::provider::FromStrategyParams::SizeT<1024>,
+    allocators::provider::FromStrategyParams::AlignmentT<64>>;
+using InlineBuffer = allocators::strategy::InlineBuffer</*N=*/256, FreeList>;
@@ -0,0 +1,108 @@
+#include "catch2/catch_all.hpp"
+
+#include <algorithm>
+#include <array>
+#include <tuple>
+
+#include <allocators/provider/lock_free_page.hpp>
+#include <allocators/strategy/freelist.hpp>
+#include <allocators/strategy/lock_free_bump.hpp>
+
+#include "../util.hpp"
+
+using namespace allocators;
+
+using Provider = provider::LockFreePage<>;
+
+static_assert(BatchProviderTrait<Provider>);
+static_assert(BatchStrategyTrait<strategy::FreeList<Provider>>);
+static_assert(BatchStrategyTrait<strategy::LockFreeBump<Provider>>);
+
+using BatchStrategies =
+    std::tuple<strategy::FreeList<Provider>, strategy::LockFreeBump<Provider>>;
+
+TEMPLATE_LIST_TEST_CASE("Strategy fills batch of allocations",
+                        "[functional][allocator][Batch]", BatchStrategies) {
+  static constexpr std::size_t kSize = 24;
+  static constexpr std::size_t kBatchSize = 32;
+
+  Provider provider;
+  TestType strategy(provider);
+
+  std::array<std::byte*, kBatchSize> batch = {};
+  REQUIRE(strategy.FindBatch(Layout(kSize, 8), batch).has_value());
+
+  SECTION("With distinct, non-overlapping allocations") {
+    std::sort(batch.begin(), batch.end());
+    for (std::size_t i = 0; i + 1 < batch.size(); ++i)
+      REQUIRE(batch[i] + kSize <= batch[i + 1]);
+
+    for (std::byte* p : batch)
+      std::fill(p, p + kSize, std::byte(0xAB));
+  }
+
+  SECTION("That can be followed by single allocations") {
+    std::byte* p = GetValueOrFail<std::byte*>(strategy.Find(kSize));
+    REQUIRE(std::find(batch.begin(), batch.end(), p) == batch.end());
+  }
+
+  SECTION("But can't fill batch larger than a block") {
+    std::array<std::byte*, 2> large = {};
+    REQUIRE(strategy.FindBatch(Layout(provider.GetBlockSize(), 8), large) ==
+            cpp::fail(Error::SizeRequestTooLarge));
+  }
+}
+
+TEST_CASE("FreeList allocator returns batch of allocations",
+          "[functional][allocator][Batch][FreeList]") {
+  static constexpr std::size_t kBatchSize = 32;
+
+  Provider provider;
+  strategy::FreeList<Provider> strategy(provider);
+
+  std::array<std::byte*, kBatchSize> batch = {};
+  REQUIRE(strategy.FindBatch(Layout(64, 8), batch).has_value());
+  REQUIRE(strategy.ReturnBatch(batch).has_value());
+
+  SECTION("Allowing space to be reused") {
+    std::array<std::byte*, kBatchSize> reused = {};
+    REQUIRE(strategy.FindBatch(Layout(64, 8), reused).has_value());
+    REQUIRE(*std::min_element(reused.begin(), reused.end()) ==
+            *std::min_element(batch.begin(), batch.end()));
+  }
+
+  SECTION("Spanning multiple blocks when batch is larger than one") {
+    std::array<std::byte*, 4 * kBatchSize> large = {};
+    REQUIRE(strategy.FindBatch(Layout(256, 8), large).has_value());
+    REQUIRE(strategy.ReturnBatch(large).has_value());
+  }
+
+  SECTION("But rejecting pointers it doesn't own") {
+    std::byte byte;
+    std::array<std::byte*, 1> foreign = {&byte};
+    REQUIRE(strategy.ReturnBatch(foreign) == cpp::fail(Error::InvalidInput));
+  }
+}
+
+TEST_CASE("FreeList allocator without headers rolls back a failed batch",
+          "[functional][allocator][Batch][FreeList]") {
+  using Params = strategy::FreeListParams;
+  using SmallProvider =
+      provider::LockFreePage<provider::LockFreePageParams::LimitT<2>>;
+
+  SmallProvider provider;
+  strategy::FreeList<SmallProvider,
+                     Params::SizeTrackingT<Params::SizeTracking::ByCaller>>
+      strategy(provider);
+
+  // Every allocation takes a block of its own, so the third one fails.
+  Layout layout(SmallProvider::GetBlockSize() / 2 + 1, 8);
+  std::array<std::byte*, 3> batch = {};
+  auto result = strategy.FindBatch(layout, batch);
+  REQUIRE(result.has_error());
+  REQUIRE(result.error() != Error::OperationNotSupported);
+
+  // Both blocks were given back.
+  std::array<std::byte*, 2> fits = {};
+  REQUIRE(strategy.FindBatch(layout, fits).has_value());
+}
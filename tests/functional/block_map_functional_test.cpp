@@ -85,3 +85,26 @@ TEST_CASE("BlockMap returns std::nullopt if given unknown key",
   auto actual_or = block_as_map->Take(va_range.address);
   REQUIRE(!actual_or.has_value());
 }
+
+TEST_CASE("BlockMap finds colliding entries after others are taken",
+          "[functional][internal][BlockMap]") {
+  TypedBlockMap* block_as_map = AsBlockMapPtr<kBlockSize>(GetBlockZeroedOut());
+
+  // Keys that are multiples of the capacity share the same slot, and the
+  // entries inserted in between sit on the same probe run.
+  std::size_t capacity = block_as_map->GetCapacity();
+  for (std::uint64_t i = 1; i <= 4; ++i) {
+    REQUIRE(block_as_map->Insert({.address = i * capacity, .count = 1}));
+    REQUIRE(block_as_map->Insert({.address = i * capacity + 1, .count = 1}));
+  }
+
+  REQUIRE(block_as_map->Take(capacity).has_value());
+  REQUIRE(block_as_map->Take(2 * capacity + 1).has_value());
+
+  for (std::uint64_t i = 2; i <= 4; ++i)
+    REQUIRE(block_as_map->Take(i * capacity).has_value());
+  for (std::uint64_t i : {1, 3, 4})
+    REQUIRE(block_as_map->Take(i * capacity + 1).has_value());
+
+  REQUIRE(block_as_map->IsEmpty());
+}
@@ -0,0 +1,145 @@
+#include "catch2/catch_all.hpp"
+
+#include <allocators/provider/lock_free_page.hpp>
+#include <allocators/provider/static.hpp>
+#include <allocators/strategy/bucketizer.hpp>
+#include <allocators/strategy/fallback.hpp>
+#include <allocators/strategy/ring.hpp>
+#include <allocators/strategy/segregator.hpp>
+#include <allocators/strategy/stack.hpp>
+
+#include "../util.hpp"
+
+using namespace allocators;
+
+using Provider = provider::LockFreePage<>;
+using Ring = strategy::Ring<Provider>;
+using Stack = strategy::Stack<Provider>;
+
+static constexpr std::size_t kThreshold = 64;
+static constexpr std::size_t kBlockSize = 1024;
+static constexpr std::size_t kRequestSize = 100;
+
+TEST_CASE("Segregator routes requests by size",
+          "[functional][allocator][Segregator]") {
+  Provider provider;
+  Stack small(provider);
+  Ring large(provider);
+  strategy::Segregator<kThreshold, Stack, Ring> allocator(small, large);
+
+  std::byte* small_ptr = GetValueOrFail<std::byte*>(allocator.Find(kThreshold));
+  std::byte* large_ptr =
+      GetValueOrFail<std::byte*>(allocator.Find(kThreshold + 1));
+
+  REQUIRE(small.Owns(small_ptr));
+  REQUIRE_FALSE(small.Owns(large_ptr));
+  REQUIRE(large.Owns(large_ptr));
+  REQUIRE(allocator.Owns(small_ptr));
+  REQUIRE(allocator.Owns(large_ptr));
+
+  SECTION("And routes returns to the owning strategy") {
+    REQUIRE(allocator.Return(large_ptr).has_value());
+    REQUIRE(allocator.Return(small_ptr).has_value());
+  }
+
+  SECTION("And routes sized returns by size") {
+    REQUIRE(allocator.Return(large_ptr, Layout(kThreshold + 1, 8)).has_value());
+    REQUIRE(allocator.Return(small_ptr, Layout(kThreshold, 8)).has_value());
+  }
+
+  SECTION("And leaves both strategies alone on reset") {
+    REQUIRE(allocator.Reset().has_value());
+    REQUIRE(small.Owns(small_ptr));
+    REQUIRE(large.Owns(large_ptr));
+  }
+}
+
+TEST_CASE("Fallback retries on secondary when primary is out of space",
+          "[functional][allocator][Fallback]") {
+  using SmallRing = strategy::Ring<provider::Static<kBlockSize>>;
+
+  provider::Static<kBlockSize> static_provider;
+  Provider provider;
+  SmallRing primary(static_provider);
+  Stack secondary(provider);
+  strategy::Fallback<SmallRing, Stack> allocator(primary, secondary);
+
+  // Fill up the primary strategy.
+  std::byte* primary_ptr = nullptr;
+  while (true) {
+    std::byte* ptr = GetValueOrFail<std::byte*>(allocator.Find(kRequestSize));
+    if (!primary.Owns(ptr)) {
+      REQUIRE(secondary.Owns(ptr));
+      REQUIRE(allocator.Return(ptr).has_value());
+      break;
+    }
+    primary_ptr = ptr;
+  }
+
+  SECTION("Requests that never fit in primary go to secondary") {
+    std::byte* ptr = GetValueOrFail<std::byte*>(allocator.Find(kBlockSize));
+    REQUIRE(secondary.Owns(ptr));
+  }
+
+  SECTION("Malformed requests are not retried") {
+    REQUIRE(allocator.Find(0) == cpp::fail(Error::InvalidInput));
+  }
+
+  SECTION("Returns are routed to the owning strategy") {
+    REQUIRE(primary.Owns(primary_ptr));
+    REQUIRE(allocator.Return(primary_ptr).has_value());
+  }
+
+  SECTION("Reset leaves both strategies alone") {
+    REQUIRE(allocator.Reset().has_value());
+    REQUIRE(primary.Owns(primary_ptr));
+  }
+}
+
+TEST_CASE("Bucketizer fans requests out to buckets by size",
+          "[functional][allocator][Bucketizer]") {
+  using AllocatorUnderTest = strategy::Bucketizer<Stack, 0, 64, 16>;
+  static_assert(AllocatorUnderTest::kBucketCount == 4);
+
+  Provider provider;
+  AllocatorUnderTest allocator(provider);
+
+  std::byte* a = GetValueOrFail<std::byte*>(allocator.Find(1));
+  std::byte* b = GetValueOrFail<std::byte*>(allocator.Find(16));
+  std::byte* c = GetValueOrFail<std::byte*>(allocator.Find(17));
+
+  // Requests in the same bucket are served by the same instance, so they are
+  // next to each other.
+  REQUIRE(b > a);
+  REQUIRE(b - a < 64);
+  REQUIRE(allocator.Owns(c));
+
+  SECTION("Requests outside of the range fail") {
+    REQUIRE(allocator.Find(65) == cpp::fail(Error::SizeRequestTooLarge));
+  }
+
+  SECTION("Returns are routed to the owning bucket") {
+    REQUIRE(allocator.Return(c).has_value());
+    REQUIRE(allocator.Return(b).has_value());
+    REQUIRE(allocator.Return(a).has_value());
+  }
+
+  SECTION("Sized returns are routed to the bucket for their size") {
+    REQUIRE(allocator.Return(c, Layout(17, 8)).has_value());
+    REQUIRE(allocator.Return(b, Layout(16, 8)).has_value());
+    REQUIRE(allocator.Return(a, Layout(1, 8)).has_value());
+    REQUIRE(allocator.Return(a, Layout(65, 8)) ==
+            cpp::fail(Error::InvalidInput));
+  }
+
+  SECTION("Reset resets every bucket") {
+    REQUIRE(allocator.Reset().has_value());
+    REQUIRE_FALSE(allocator.Owns(a));
+    REQUIRE_FALSE(allocator.Owns(c));
+  }
+
+  SECTION("Returning unknown pointers fails") {
+    std::byte unknown;
+    REQUIRE(allocator.Return(&unknown) == cpp::fail(Error::InvalidInput));
+  }
+}
@@ -1,5 +1,11 @@
+#include <algorithm>
 #include <array>
 #include <cstddef>
+#include <cstring>
+#include <optional>
+#include <random>
+#include <utility>
+#include <vector>
 
 #include "catch2/catch_all.hpp"
 #include "magic_enum.hpp"
@@ -10,6 +16,7 @@
 #include "../util.hpp"
 #include <allocators/provider/lock_free_page.hpp>
 #include <allocators/provider/static.hpp>
+#include <allocators/provider/unsynchronized_page.hpp>
 
 using namespace allocators;
 
@@ -22,16 +29,31 @@ static constexpr std::size_t N = kBlockSize / kChunkSize;
 
 template <class... Allocator> struct AllocatorPack {};
 
+// Fit policy that picks the free block at the highest address.
+struct LastFit {
+  template <class Header>
+  static internal::Failable<std::optional<internal::HeaderPair<Header>>>
+  Find(Header* head, std::size_t minimum_size) {
+    std::optional<internal::HeaderPair<Header>> target = std::nullopt;
+    for (Header *itr = head, *prev = nullptr; itr != nullptr;
+         prev = itr, itr = itr->GetNext())
+      if (itr->GetSize() >= minimum_size)
+        target = internal::HeaderPair<Header>(itr, prev);
+
+    return target;
+  }
+};
+
 template <class... Args>
 using FixedFreeList = strategy::FreeList<provider::LockFreePage<>, Args...>;
 
-using FixedFreeListAllocators = AllocatorPack<FixedFreeList<>>;
+using FixedFreeListAllocators = AllocatorPack<
+    FixedFreeList<>, FixedFreeList<strategy::FreeListParams::HeaderT<
+                         strategy::FreeListParams::HeaderLayout::Compact>>>;
 
 TEMPLATE_LIST_TEST_CASE("Fixed FreeList allocator that can fit N objects",
                         "[allocator][FreeList][fixed]",
                         FixedFreeListAllocators) {
-  // TODO: Enable once fixed.
-  SKIP();
   provider::LockFreePage<> provider;
   TestType allocator(provider);
 
@@ -57,3 +79,683 @@ TEMPLATE_LIST_TEST_CASE("Fixed FreeList allocator that can fit N objects",
     }
   }
 }
+
+TEST_CASE("FreeList allocator grows past a single block",
+          "[allocator][FreeList]") {
+  provider::LockFreePage<> provider;
+  FixedFreeList<> allocator(provider);
+
+  std::array<T*, 4 * N> allocs;
+  for (std::size_t i = 0; i < allocs.size(); ++i)
+    allocs[i] = GetPtrOrFail<T>(allocator.Find(SizeOfT));
+
+  for (std::size_t i = 0; i < allocs.size(); ++i)
+    REQUIRE(allocator.Owns(ToBytePtr(allocs[i])));
+
+  SECTION("Can release all allocations in any order") {
+    for (std::size_t i = 0; i < allocs.size(); i += 2)
+      REQUIRE(allocator.Return(ToBytePtr(allocs[i])).has_value());
+    for (std::size_t i = 1; i < allocs.size(); i += 2)
+      REQUIRE(allocator.Return(ToBytePtr(allocs[i])).has_value());
+
+    SECTION("Allowing request spanning a whole block") {
+      std::size_t size = kBlockSize - 2 * internal::GetBlockHeaderSize();
+      std::byte* chunk = GetValueOrFail<std::byte*>(allocator.Find(size));
+      REQUIRE(allocator.Return(chunk).has_value());
+    }
+  }
+
+  SECTION("Reset releases every block") {
+    REQUIRE(allocator.Reset().has_value());
+    REQUIRE(!allocator.Owns(ToBytePtr(allocs.front())));
+    REQUIRE(allocator.Return(ToBytePtr(allocs.back())) ==
+            cpp::fail(Error::InvalidInput));
+  }
+
+  SECTION("Reset can keep every block") {
+    using Params = strategy::FreeListParams;
+    REQUIRE(allocator.Reset(Params::ResetMode::KeepBlocks).has_value());
+    REQUIRE(allocator.Owns(ToBytePtr(allocs.front())));
+
+    // Every block is a single free span again, starting where its first
+    // allocation used to be.
+    std::size_t size = kBlockSize - 2 * internal::GetBlockHeaderSize();
+    for (std::size_t i = 0; i < 4; ++i) {
+      std::byte* chunk = GetValueOrFail<std::byte*>(allocator.Find(size));
+      REQUIRE(std::find(allocs.begin(), allocs.end(),
+                        reinterpret_cast<T*>(chunk)) != allocs.end());
+    }
+  }
+}
+
+TEST_CASE("FreeList allocator without allocation headers",
+          "[allocator][FreeList]") {
+  using Headerless = FixedFreeList<strategy::FreeListParams::SizeTrackingT<
+      strategy::FreeListParams::SizeTracking::ByCaller>>;
+
+  static constexpr std::size_t kObjectSize = 16;
+  static constexpr Layout kLayout = Layout(kObjectSize, 8);
+  static constexpr std::size_t M =
+      (kBlockSize - internal::GetBlockHeaderSize()) / kObjectSize;
+
+  provider::LockFreePage<> provider;
+  Headerless allocator(provider);
+
+  SECTION("Packs objects without any space in between") {
+    std::array<std::byte*, M> allocs;
+    for (std::size_t i = 0; i < M; ++i)
+      allocs[i] = GetValueOrFail<std::byte*>(allocator.Find(kLayout));
+
+    for (std::size_t i = 0; i + 1 < M; ++i)
+      REQUIRE(allocs[i] + kObjectSize == allocs[i + 1]);
+
+    SECTION("Which can be returned with their layout") {
+      for (std::size_t i = 0; i < M; i += 2)
+        REQUIRE(allocator.Return(allocs[i], kLayout).has_value());
+      for (std::size_t i = 1; i < M; i += 2)
+        REQUIRE(allocator.Return(allocs[i], kLayout).has_value());
+
+      std::size_t size = kBlockSize - internal::GetBlockHeaderSize();
+      REQUIRE(GetValueOrFail<std::byte*>(allocator.Find(size)) == allocs[0]);
+    }
+  }
+
+  SECTION("Rounds odd sizes up to a multiple of the header size") {
+    std::byte* a = GetValueOrFail<std::byte*>(allocator.Find(Layout(1, 8)));
+    std::byte* b = GetValueOrFail<std::byte*>(allocator.Find(Layout(17, 8)));
+    std::byte* c = GetValueOrFail<std::byte*>(allocator.Find(Layout(8, 8)));
+    REQUIRE(b == a + 16);
+    REQUIRE(c == b + 32);
+
+    REQUIRE(allocator.Return(b, Layout(17, 8)).has_value());
+    REQUIRE(GetValueOrFail<std::byte*>(allocator.Find(Layout(32, 8))) == b);
+  }
+
+  SECTION("But can't return without a layout") {
+    std::byte* p = GetValueOrFail<std::byte*>(allocator.Find(kLayout));
+    REQUIRE(allocator.Return(p) == cpp::fail(Error::OperationNotSupported));
+  }
+}
+
+TEST_CASE("FreeList allocator with compact headers",
+          "[allocator][FreeList]") {
+  using Compact = FixedFreeList<strategy::FreeListParams::HeaderT<
+      strategy::FreeListParams::HeaderLayout::Compact>>;
+
+  static constexpr std::size_t kHeaderSize =
+      internal::GetBlockHeaderSize<internal::CompactBlockHeader>();
+  static constexpr std::size_t M =
+      (kBlockSize - internal::GetBlockHeaderSize()) / (SizeOfT + kHeaderSize);
+
+  provider::LockFreePage<> provider;
+  Compact allocator(provider);
+
+  SECTION("Fits more objects per block") {
+    std::array<std::byte*, M> allocs;
+    for (std::size_t i = 0; i < M; ++i)
+      allocs[i] = GetValueOrFail<std::byte*>(allocator.Find(SizeOfT));
+
+    for (std::size_t i = 0; i + 1 < M; ++i)
+      REQUIRE(allocs[i] + SizeOfT + kHeaderSize == allocs[i + 1]);
+
+    SECTION("Which coalesce once returned") {
+      for (std::size_t i = 0; i < M; i += 2)
+        REQUIRE(allocator.Return(allocs[i]).has_value());
+      for (std::size_t i = 1; i < M; i += 2)
+        REQUIRE(allocator.Return(allocs[i]).has_value());
+
+      std::size_t size = kBlockSize - internal::GetBlockHeaderSize() -
+                         kHeaderSize;
+      REQUIRE(GetValueOrFail<std::byte*>(allocator.Find(size)) == allocs[0]);
+    }
+  }
+
+  SECTION("Can resize in place") {
+    std::byte* a = GetValueOrFail<std::byte*>(allocator.Find(SizeOfT));
+    REQUIRE(allocator.Resize(a, Layout(4 * SizeOfT, 8)).has_value());
+    std::byte* b = GetValueOrFail<std::byte*>(allocator.Find(SizeOfT));
+    REQUIRE(b == a + 4 * SizeOfT + kHeaderSize);
+  }
+}
+
+TEST_CASE("FreeList allocator zeroing policies", "[allocator][FreeList]") {
+  using Params = strategy::FreeListParams;
+  static constexpr std::size_t kSize = 64;
+
+  auto fill = [](std::byte* p, std::size_t size) {
+    std::memset(p, 0xab, size);
+  };
+  auto is_zero = [](std::byte* p, std::size_t size) {
+    return std::all_of(p, p + size,
+                       [](std::byte b) { return b == std::byte(0); });
+  };
+
+  SECTION("Zeroes allocations on find") {
+    provider::LockFreePage<> provider;
+    FixedFreeList<Params::ZeroingT<Params::Zeroing::OnFind>> allocator(
+        provider);
+
+    std::byte* p = GetValueOrFail<std::byte*>(allocator.Find(kSize));
+    fill(p, kSize);
+    REQUIRE(allocator.Return(p).has_value());
+
+    std::byte* q = GetValueOrFail<std::byte*>(allocator.Find(kSize));
+    REQUIRE(q == p);
+    REQUIRE(is_zero(q, kSize));
+  }
+
+  SECTION("Zeroes allocations on return") {
+    provider::LockFreePage<> provider;
+    FixedFreeList<Params::ZeroingT<Params::Zeroing::OnReturn>> allocator(
+        provider);
+
+    std::byte* p = GetValueOrFail<std::byte*>(allocator.Find(kSize));
+    fill(p, kSize);
+    REQUIRE(allocator.Return(p).has_value());
+
+    // |p| is merged into a free block large enough to be indexed by size,
+    // whose node in the index takes its first bytes.
+    static constexpr std::size_t kNodeSize = 4 * sizeof(void*);
+    REQUIRE(is_zero(p + kNodeSize, kSize - kNodeSize));
+  }
+
+  SECTION("Zeroes on request without a policy") {
+    provider::LockFreePage<> provider;
+    FixedFreeList<> allocator(provider);
+
+    std::byte* p = GetValueOrFail<std::byte*>(allocator.Find(kSize));
+    fill(p, kSize);
+    REQUIRE(allocator.Return(p).has_value());
+
+    std::byte* q = GetValueOrFail<std::byte*>(
+        allocator.FindZeroed(Layout(kSize, internal::kMinimumAlignment)));
+    REQUIRE(q == p);
+    REQUIRE(is_zero(q, kSize));
+  }
+
+  SECTION("Tracks bytes written to in blocks of a zeroed provider") {
+    static_assert(ZeroedProviderTrait<provider::UnsynchronizedPage<>>);
+    static_assert(!ZeroedProviderTrait<provider::LockFreePage<>>);
+
+    provider::UnsynchronizedPage<> provider;
+    strategy::FreeList<provider::UnsynchronizedPage<>> allocator(provider);
+
+    std::byte* p = GetValueOrFail<std::byte*>(allocator.Find(kSize));
+    fill(p, kSize);
+    REQUIRE(allocator.Resize(p, Layout(2 * kSize, 8)).has_value());
+    fill(p, 2 * kSize);
+    REQUIRE(allocator.Return(p).has_value());
+
+    std::byte* q = GetValueOrFail<std::byte*>(
+        allocator.FindZeroed(Layout(4 * kSize, internal::kMinimumAlignment)));
+    REQUIRE(q == p);
+    REQUIRE(is_zero(q, 4 * kSize));
+  }
+}
+
+TEST_CASE("FreeList allocator with a custom fit policy",
+          "[allocator][FreeList]") {
+  using Params = strategy::FreeListParams;
+
+  provider::LockFreePage<> provider;
+  FixedFreeList<Params::SearchT<LastFit{}>> allocator(provider);
+
+  std::byte* a = GetValueOrFail<std::byte*>(allocator.Find(SizeOfT));
+  std::byte* b = GetValueOrFail<std::byte*>(allocator.Find(SizeOfT));
+  REQUIRE(GetValueOrFail<std::byte*>(allocator.Find(SizeOfT)) != nullptr);
+  REQUIRE(allocator.Return(a).has_value());
+
+  // The hole left by |a| would be the best fit, but the policy prefers the
+  // free space past the last allocation.
+  std::byte* c = GetValueOrFail<std::byte*>(allocator.Find(SizeOfT));
+  REQUIRE(c != a);
+  REQUIRE(c > b);
+}
+
+TEST_CASE("FreeList allocator with next-fit search", "[allocator][FreeList]") {
+  using Params = strategy::FreeListParams;
+  using NextFit = FixedFreeList<Params::SearchT<Params::FindBy::NextFit>>;
+
+  provider::LockFreePage<> provider;
+  NextFit allocator(provider);
+
+  SECTION("Resumes from where the previous search left off") {
+    std::array<std::byte*, 5> allocs;
+    for (auto& alloc : allocs)
+      alloc = GetValueOrFail<std::byte*>(allocator.Find(SizeOfT));
+
+    REQUIRE(allocator.Return(allocs[0]).has_value());
+    REQUIRE(allocator.Return(allocs[2]).has_value());
+
+    // Neither hole fits, so this is served past the last allocation...
+    std::byte* large = GetValueOrFail<std::byte*>(allocator.Find(4 * SizeOfT));
+    REQUIRE(large > allocs.back());
+
+    // ...and so is this, where first-fit would pick the first hole.
+    std::byte* small = GetValueOrFail<std::byte*>(allocator.Find(SizeOfT));
+    REQUIRE(small > large);
+  }
+
+  SECTION("Wraps around once the end of the free list is reached") {
+    std::byte* a = GetValueOrFail<std::byte*>(allocator.Find(SizeOfT));
+    GetValueOrFail<std::byte*>(allocator.Find(SizeOfT));
+    std::byte* c = GetValueOrFail<std::byte*>(allocator.Find(SizeOfT));
+    REQUIRE(allocator.Return(a).has_value());
+
+    // Take all that's left past |c|, leaving the rover at the very end.
+    std::size_t rest = kBlockSize - 2 * internal::GetBlockHeaderSize() -
+                       3 * kChunkSize;
+    REQUIRE(GetValueOrFail<std::byte*>(allocator.Find(rest)) > c);
+
+    REQUIRE(GetValueOrFail<std::byte*>(allocator.Find(SizeOfT)) == a);
+  }
+
+  SECTION("Survives blocks being split and merged around it") {
+    std::vector<std::byte*> allocs;
+    for (std::size_t i = 0; i < 4 * N; ++i) {
+      if (!allocs.empty() && GetRandomNumber<int>(0, 2) == 0) {
+        std::size_t index = GetRandomNumber<std::size_t>(0, allocs.size() - 1);
+        REQUIRE(allocator.Return(allocs[index]).has_value());
+        allocs.erase(allocs.begin() + index);
+        continue;
+      }
+
+      std::size_t size = SizeOfT * GetRandomNumber<std::size_t>(1, 8);
+      allocs.push_back(GetValueOrFail<std::byte*>(allocator.Find(size)));
+      std::memset(allocs.back(), 0xab, size);
+    }
+
+    for (std::byte* alloc : allocs)
+      REQUIRE(allocator.Return(alloc).has_value());
+
+    std::size_t size = kBlockSize - 2 * internal::GetBlockHeaderSize();
+    REQUIRE(GetValueOrFail<std::byte*>(allocator.Find(size)) != nullptr);
+  }
+}
+
+TEST_CASE("FreeList allocator with a size index", "[allocator][FreeList]") {
+  using Params = strategy::FreeListParams;
+  static constexpr std::size_t kThreshold = 256;
+
+  provider::LockFreePage<> provider;
+
+  SECTION("Finds the smallest large block that fits") {
+    FixedFreeList<Params::IndexThresholdT<kThreshold>> allocator(provider);
+
+    std::byte* a = GetValueOrFail<std::byte*>(allocator.Find(600));
+    GetValueOrFail<std::byte*>(allocator.Find(SizeOfT));
+    std::byte* b = GetValueOrFail<std::byte*>(allocator.Find(1000));
+    GetValueOrFail<std::byte*>(allocator.Find(SizeOfT));
+    std::byte* c = GetValueOrFail<std::byte*>(allocator.Find(700));
+    GetValueOrFail<std::byte*>(allocator.Find(SizeOfT));
+
+    REQUIRE(allocator.Return(a).has_value());
+    REQUIRE(allocator.Return(b).has_value());
+    REQUIRE(allocator.Return(c).has_value());
+
+    REQUIRE(GetValueOrFail<std::byte*>(allocator.Find(650)) == c);
+    REQUIRE(GetValueOrFail<std::byte*>(allocator.Find(900)) == b);
+    REQUIRE(GetValueOrFail<std::byte*>(allocator.Find(500)) == a);
+  }
+
+  SECTION("Finds the largest block with worst-fit search") {
+    FixedFreeList<Params::IndexThresholdT<kThreshold>,
+                  Params::SearchT<Params::FindBy::WorstFit>>
+        allocator(provider);
+
+    std::byte* a = GetValueOrFail<std::byte*>(allocator.Find(600));
+    std::byte* b = GetValueOrFail<std::byte*>(allocator.Find(2000));
+    GetValueOrFail<std::byte*>(allocator.Find(SizeOfT));
+    REQUIRE(allocator.Return(b).has_value());
+
+    // The hole left by |b| is larger than what's left past it.
+    REQUIRE(GetValueOrFail<std::byte*>(allocator.Find(SizeOfT)) == b);
+    REQUIRE(allocator.Return(a).has_value());
+  }
+
+  SECTION("Stays in sync with the free lists") {
+    FixedFreeList<Params::IndexThresholdT<kThreshold>> allocator(provider);
+
+    struct Allocation {
+      std::byte* ptr;
+      std::size_t size;
+      std::byte fill;
+    };
+
+    auto is_intact = [](const Allocation& alloc) {
+      return std::all_of(alloc.ptr, alloc.ptr + alloc.size,
+                         [&](std::byte b) { return b == alloc.fill; });
+    };
+
+    std::vector<Allocation> allocs;
+    for (std::size_t i = 0; i < 2000; ++i) {
+      int op = GetRandomNumber<int>(0, 3);
+      if (!allocs.empty() && op == 0) {
+        std::size_t index = GetRandomNumber<std::size_t>(0, allocs.size() - 1);
+        REQUIRE(is_intact(allocs[index]));
+        REQUIRE(allocator.Return(allocs[index].ptr).has_value());
+        allocs.erase(allocs.begin() + index);
+        continue;
+      }
+
+      if (!allocs.empty() && op == 1) {
+        Allocation& alloc = allocs.back();
+        std::size_t size = GetRandomNumber<std::size_t>(1, 1200);
+        if (allocator
+                .Resize(alloc.ptr, Layout(size, internal::kMinimumAlignment))
+                .has_value()) {
+          alloc.size = size;
+          std::memset(alloc.ptr, static_cast<int>(alloc.fill), size);
+        }
+
+        continue;
+      }
+
+      std::size_t size = GetRandomNumber<std::size_t>(1, 1200);
+      auto fill = static_cast<std::byte>(i);
+      allocs.push_back(
+          {GetValueOrFail<std::byte*>(allocator.Find(size)), size, fill});
+      std::memset(allocs.back().ptr, static_cast<int>(fill), size);
+    }
+
+    for (const Allocation& alloc : allocs) {
+      REQUIRE(is_intact(alloc));
+      REQUIRE(allocator.Return(alloc.ptr).has_value());
+    }
+
+    std::size_t size = kBlockSize - 2 * internal::GetBlockHeaderSize();
+    REQUIRE(GetValueOrFail<std::byte*>(allocator.Find(size)) != nullptr);
+  }
+}
+
+TEST_CASE("FreeList allocator with fast bins", "[allocator][FreeList]") {
+  using Params = strategy::FreeListParams;
+  static constexpr std::size_t kMaxSize = 128;
+
+  provider::LockFreePage<> provider;
+
+  SECTION("Reuses the most recently returned block of the same size") {
+    FixedFreeList<Params::FastBinsT<kMaxSize>> allocator(provider);
+
+    std::byte* a = GetValueOrFail<std::byte*>(allocator.Find(SizeOfT));
+    std::byte* b = GetValueOrFail<std::byte*>(allocator.Find(SizeOfT));
+    GetValueOrFail<std::byte*>(allocator.Find(SizeOfT));
+    REQUIRE(allocator.Return(a).has_value());
+    REQUIRE(allocator.Return(b).has_value());
+
+    REQUIRE(GetValueOrFail<std::byte*>(allocator.Find(SizeOfT)) == b);
+    REQUIRE(GetValueOrFail<std::byte*>(allocator.Find(SizeOfT)) == a);
+  }
+
+  SECTION("Coalesces binned blocks once a search fails") {
+    FixedFreeList<Params::FastBinsT<kMaxSize>> allocator(provider);
+
+    std::array<std::byte*, N> allocs;
+    for (std::size_t i = 0; i < N; ++i)
+      allocs[i] = GetValueOrFail<std::byte*>(allocator.Find(SizeOfT));
+
+    for (std::byte* alloc : allocs)
+      REQUIRE(allocator.Return(alloc).has_value());
+
+    std::size_t size = kBlockSize - 2 * internal::GetBlockHeaderSize();
+    REQUIRE(GetValueOrFail<std::byte*>(allocator.Find(size)) == allocs[0]);
+  }
+
+  SECTION("Flushes a bin that grows past its depth") {
+    FixedFreeList<Params::FastBinsT<kMaxSize>, Params::FastBinDepthT<2>>
+        allocator(provider);
+
+    std::array<std::byte*, 3> allocs;
+    for (auto& alloc : allocs)
+      alloc = GetValueOrFail<std::byte*>(allocator.Find(SizeOfT));
+    GetValueOrFail<std::byte*>(allocator.Find(SizeOfT));
+
+    for (std::byte* alloc : allocs)
+      REQUIRE(allocator.Return(alloc).has_value());
+
+    // All three were merged into a single free block.
+    std::size_t size = 3 * kChunkSize - internal::GetBlockHeaderSize();
+    REQUIRE(GetValueOrFail<std::byte*>(allocator.Find(size)) == allocs[0]);
+  }
+
+  SECTION("Leaves larger blocks to the free list") {
+    FixedFreeList<Params::FastBinsT<kMaxSize>> allocator(provider);
+
+    std::byte* a = GetValueOrFail<std::byte*>(allocator.Find(kMaxSize));
+    std::byte* b = GetValueOrFail<std::byte*>(allocator.Find(kMaxSize));
+    GetValueOrFail<std::byte*>(allocator.Find(SizeOfT));
+    REQUIRE(allocator.Return(a).has_value());
+    REQUIRE(allocator.Return(b).has_value());
+
+    std::size_t size = 2 * kMaxSize + internal::GetBlockHeaderSize();
+    REQUIRE(GetValueOrFail<std::byte*>(allocator.Find(size)) == a);
+  }
+}
+
+TEST_CASE("FreeList allocator with deferred coalescing",
+          "[allocator][FreeList]") {
+  using Params = strategy::FreeListParams;
+  using Deferred =
+      FixedFreeList<Params::CoalescingT<Params::Coalescing::Deferred>>;
+
+  provider::LockFreePage<> provider;
+  Deferred allocator(provider);
+
+  SECTION("Leaves returned blocks alone until compacted") {
+    std::array<std::byte*, 3> allocs;
+    for (auto& alloc : allocs)
+      alloc = GetValueOrFail<std::byte*>(allocator.Find(SizeOfT));
+    GetValueOrFail<std::byte*>(allocator.Find(SizeOfT));
+
+    REQUIRE(allocator.Return(allocs[1]).has_value());
+    REQUIRE(allocator.Return(allocs[0]).has_value());
+    REQUIRE(allocator.Return(allocs[2]).has_value());
+
+    std::size_t size = 3 * kChunkSize - internal::GetBlockHeaderSize();
+    std::byte* ptr = GetValueOrFail<std::byte*>(allocator.Find(size));
+    REQUIRE(ptr > allocs[2]);
+    REQUIRE(allocator.Return(ptr).has_value());
+
+    REQUIRE(allocator.Compact().has_value());
+    REQUIRE(GetValueOrFail<std::byte*>(allocator.Find(size)) == allocs[0]);
+  }
+
+  SECTION("Merges returned blocks once a search fails") {
+    std::vector<std::byte*> allocs;
+    for (std::size_t i = 0; i < N; ++i)
+      allocs.push_back(GetValueOrFail<std::byte*>(allocator.Find(SizeOfT)));
+
+    std::mt19937 engine(std::random_device{}());
+    std::vector<std::byte*> shuffled = allocs;
+    std::shuffle(shuffled.begin(), shuffled.end(), engine);
+    for (std::byte* alloc : shuffled)
+      REQUIRE(allocator.Return(alloc).has_value());
+
+    std::size_t size = kBlockSize - 3 * internal::GetBlockHeaderSize();
+    REQUIRE(GetValueOrFail<std::byte*>(allocator.Find(size)) == allocs[0]);
+  }
+
+  SECTION("Keeps allocations intact across merge passes") {
+    std::vector<std::pair<std::byte*, std::size_t>> allocs;
+    for (std::size_t i = 0; i < 2000; ++i) {
+      int op = GetRandomNumber<int>(0, 9);
+      if (op == 0) {
+        REQUIRE(allocator.Compact().has_value());
+      } else if (!allocs.empty() && op < 5) {
+        std::size_t index = GetRandomNumber<std::size_t>(0, allocs.size() - 1);
+        auto [ptr, size] = allocs[index];
+        REQUIRE(std::all_of(ptr, ptr + size, [&](std::byte b) {
+          return b == static_cast<std::byte>(size);
+        }));
+        REQUIRE(allocator.Return(ptr).has_value());
+        allocs.erase(allocs.begin() + index);
+      } else {
+        std::size_t size = GetRandomNumber<std::size_t>(1, 600);
+        std::byte* ptr = GetValueOrFail<std::byte*>(allocator.Find(size));
+        std::memset(ptr, static_cast<int>(size), size);
+        allocs.emplace_back(ptr, size);
+      }
+    }
+
+    for (auto [ptr, size] : allocs)
+      REQUIRE(allocator.Return(ptr).has_value());
+
+    std::size_t size = kBlockSize - 3 * internal::GetBlockHeaderSize();
+    REQUIRE(GetValueOrFail<std::byte*>(allocator.Find(size)) != nullptr);
+  }
+}
+
+TEST_CASE("FreeList allocator block retention", "[allocator][FreeList]") {
+  using Params = strategy::FreeListParams;
+  static constexpr std::size_t kWholeBlock =
+      kBlockSize - 2 * internal::GetBlockHeaderSize();
+
+  provider::LockFreePage<> provider;
+
+  SECTION("Holds onto empty blocks by default") {
+    FixedFreeList<> allocator(provider);
+
+    std::byte* a = GetValueOrFail<std::byte*>(allocator.Find(kWholeBlock));
+    REQUIRE(allocator.Return(a).has_value());
+    REQUIRE(allocator.Owns(a));
+
+    SECTION("Until trimmed") {
+      REQUIRE(allocator.Trim().has_value());
+      REQUIRE(!allocator.Owns(a));
+      REQUIRE(GetValueOrFail<std::byte*>(allocator.Find(SizeOfT)) != nullptr);
+    }
+  }
+
+  SECTION("Releases empty blocks past those retained") {
+    FixedFreeList<Params::RetainedBlocksT<1>> allocator(provider);
+
+    std::byte* a = GetValueOrFail<std::byte*>(allocator.Find(kWholeBlock));
+    std::byte* b = GetValueOrFail<std::byte*>(allocator.Find(kWholeBlock));
+    REQUIRE(allocator.Return(a).has_value());
+    REQUIRE(allocator.Owns(a));
+
+    REQUIRE(allocator.Return(b).has_value());
+    REQUIRE(allocator.Owns(a) != allocator.Owns(b));
+  }
+
+  SECTION("Trim keeps blocks with allocations") {
+    FixedFreeList<> allocator(provider);
+
+    std::byte* a = GetValueOrFail<std::byte*>(allocator.Find(kWholeBlock));
+    std::byte* b = GetValueOrFail<std::byte*>(allocator.Find(kWholeBlock));
+    REQUIRE(allocator.Return(b).has_value());
+    REQUIRE(allocator.Trim().has_value());
+    REQUIRE(allocator.Owns(a));
+    REQUIRE(!allocator.Owns(b));
+  }
+
+  SECTION("Resets the next-fit search when its block is released") {
+    FixedFreeList<Params::SearchT<Params::FindBy::NextFit>,
+                  Params::RetainedBlocksT<0>>
+        allocator(provider);
+
+    for (int i = 0; i < 3; ++i) {
+      std::byte* a = GetValueOrFail<std::byte*>(allocator.Find(SizeOfT));
+      REQUIRE(allocator.Return(a).has_value());
+      REQUIRE(!allocator.Owns(a));
+    }
+  }
+
+  SECTION("Releases blocks emptied by a merge pass") {
+    FixedFreeList<Params::FastBinsT<64>, Params::RetainedBlocksT<0>>
+        allocator(provider);
+
+    std::byte* a = GetValueOrFail<std::byte*>(allocator.Find(SizeOfT));
+    REQUIRE(allocator.Return(a).has_value());
+    REQUIRE(allocator.Owns(a));
+
+    REQUIRE(allocator.Compact().has_value());
+    REQUIRE(!allocator.Owns(a));
+  }
+}
+
+// Provider of blocks spanning several pages, so that page-aligned
+// allocations fit in one.
+template <std::size_t Pages> class MultiPage {
+public:
+  Result<std::byte*> Provide(std::size_t count) {
+    auto range_or = internal::FetchPages(Pages);
+    if (count != 1 || range_or.has_error())
+      return cpp::fail(Error::OutOfMemory);
+
+    return reinterpret_cast<std::byte*>(range_or.value().address);
+  }
+
+  Result<void> Return(std::byte* ptr) {
+    auto range = internal::VirtualAddressRange{
+        .address = internal::AsUint(ptr), .count = Pages};
+    if (internal::ReturnPages(range).has_error())
+      return cpp::fail(Error::Internal);
+
+    return {};
+  }
+
+  static constexpr std::size_t GetBlockSize() {
+    return Pages * internal::GetPageSize();
+  }
+};
+
+TEST_CASE("FreeList allocator with over-aligned allocations",
+          "[allocator][FreeList]") {
+  using Params = strategy::FreeListParams;
+  using Provider = MultiPage<4>;
+  std::size_t alignment = GENERATE(16, 64, 256, 4096);
+
+  Provider provider;
+
+  SECTION("Aligns allocations without wasting the padding") {
+    strategy::FreeList<Provider> allocator(provider);
+
+    std::vector<std::byte*> allocs;
+    for (std::size_t i = 0; i < 8; ++i) {
+      allocs.push_back(GetValueOrFail<std::byte*>(allocator.Find(SizeOfT)));
+      std::byte* ptr =
+          GetValueOrFail<std::byte*>(allocator.Find(Layout(100, alignment)));
+      REQUIRE(internal::AsUint(ptr) % alignment == 0);
+      std::memset(ptr, 0xab, 100);
+      allocs.push_back(ptr);
+    }
+
+    for (std::byte* alloc : allocs)
+      REQUIRE(allocator.Return(alloc).has_value());
+
+    // Every byte of padding went back to the free list.
+    std::size_t size = Provider::GetBlockSize() -
+                       2 * internal::GetBlockHeaderSize();
+    std::byte* ptr = GetValueOrFail<std::byte*>(allocator.Find(size));
+    REQUIRE(allocator.Return(ptr).has_value());
+  }
+
+  SECTION("Aligns allocations without headers") {
+    strategy::FreeList<Provider, Params::SizeTrackingT<
+                                     Params::SizeTracking::ByCaller>>
+        allocator(provider);
+
+    Layout small(SizeOfT, SizeOfT);
+    Layout aligned(100, alignment);
+    std::byte* a = GetValueOrFail<std::byte*>(allocator.Find(small));
+    std::byte* b = GetValueOrFail<std::byte*>(allocator.Find(aligned));
+    REQUIRE(internal::AsUint(b) % alignment == 0);
+
+    REQUIRE(allocator.Return(a, small).has_value());
+    REQUIRE(allocator.Return(b, aligned).has_value());
+    REQUIRE(GetValueOrFail<std::byte*>(allocator.Find(small)) == a);
+  }
+
+  SECTION("Aligns every allocation to kAlignment") {
+    strategy::FreeList<Provider, Params::AlignmentT<64>,
+                       Params::HeaderT<Params::HeaderLayout::Compact>>
+        allocator(provider);
+
+    for (std::size_t i = 0; i < 16; ++i)
+      REQUIRE(internal::AsUint(GetValueOrFail<std::byte*>(
+                  allocator.Find(SizeOfT))) %
+                  64 ==
+              0);
+  }
+}
@@ -0,0 +1,95 @@
+#include "catch2/catch_all.hpp"
+
+#include <array>
+
+#include <allocators/provider/from_strategy.hpp>
+#include <allocators/provider/lock_free_page.hpp>
+#include <allocators/strategy/freelist.hpp>
+#include <allocators/strategy/lock_free_bump.hpp>
+
+#include "../util.hpp"
+
+using namespace allocators;
+
+using T = long;
+static constexpr std::size_t SizeOfT = sizeof(T);
+static constexpr std::size_t kBlockSize = 1024;
+
+using Page = provider::LockFreePage<>;
+
+TEST_CASE("FromStrategy provider carves blocks out of a strategy",
+          "[functional][provider][FromStrategy]") {
+  using Parent = strategy::FreeList<Page>;
+  using Provider = provider::FromStrategy<
+      Parent, provider::FromStrategyParams::SizeT<kBlockSize>>;
+
+  Page page;
+  Parent parent(page);
+  Provider provider(parent);
+
+  REQUIRE(provider.GetBlockSize() == kBlockSize);
+
+  std::byte* block = GetValueOrFail<std::byte*>(provider.Provide(1));
+  REQUIRE(parent.Owns(block));
+
+  SECTION("And returns blocks back to the strategy") {
+    REQUIRE(provider.Return(block).has_value());
+    REQUIRE(GetValueOrFail<std::byte*>(provider.Provide(1)) == block);
+  }
+
+  SECTION("While rejecting invalid sizes") {
+    REQUIRE(provider.Provide(0) == cpp::fail(Error::InvalidInput));
+  }
+}
+
+TEST_CASE("LockFreeBump allocator can run on memory managed by FreeList",
+          "[functional][provider][FromStrategy]") {
+  using Parent = strategy::FreeList<Page>;
+  using Provider = provider::FromStrategy<
+      Parent, provider::FromStrategyParams::SizeT<kBlockSize>>;
+
+  Page page;
+  Parent parent(page);
+  Provider provider(parent);
+  strategy::LockFreeBump<Provider> allocator(provider);
+
+  // Enough objects to span multiple blocks.
+  static constexpr std::size_t N = 2 * kBlockSize / SizeOfT;
+  for (std::size_t i = 0; i < N; ++i) {
+    std::byte* p = GetValueOrFail<std::byte*>(allocator.Find(SizeOfT));
+    REQUIRE(parent.Owns(p));
+  }
+
+  REQUIRE(allocator.Reset().has_value());
+}
+
+TEST_CASE("FreeList allocator can run inside of an arena",
+          "[functional][provider][FromStrategy]") {
+  using Parent = strategy::LockFreeBump<Page>;
+  using Provider = provider::FromStrategy<
+      Parent, provider::FromStrategyParams::SizeT<kBlockSize>,
+      provider::FromStrategyParams::AlignmentT<64>>;
+
+  Page page;
+  Parent parent(page);
+  Provider provider(parent);
+  strategy::FreeList<Provider> allocator(provider);
+
+  SECTION("Blocks are aligned to the requested alignment") {
+    std::byte* block = GetValueOrFail<std::byte*>(provider.Provide(1));
+    REQUIRE(AsUint(block) % 64 == 0);
+  }
+
+  std::array<std::byte*, 10> allocs;
+  for (auto& p : allocs) {
+    p = GetValueOrFail<std::byte*>(allocator.Find(SizeOfT));
+    REQUIRE(parent.Owns(p));
+  }
+
+  for (auto* p : allocs)
+    REQUIRE(allocator.Return(p).has_value());
+
+  // The arena can't take blocks back until it's reset.
+  REQUIRE(provider.Return(allocs.front()) ==
+          cpp::fail(Error::OperationNotSupported));
+}
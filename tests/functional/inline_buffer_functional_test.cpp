@@ -0,0 +1,107 @@
+#include "catch2/catch_all.hpp"
+
+#include <array>
+
+#include <allocators/provider/lock_free_page.hpp>
+#include <allocators/strategy/inline_buffer.hpp>
+#include <allocators/strategy/stack.hpp>
+
+#include "../util.hpp"
+
+using namespace allocators;
+
+using T = long;
+static constexpr std::size_t SizeOfT = sizeof(T);
+static constexpr std::size_t N = 10;
+
+using Provider = provider::LockFreePage<>;
+using Fallback = strategy::Stack<Provider>;
+using AllocatorUnderTest = strategy::InlineBuffer<N * SizeOfT, Fallback>;
+
+TEST_CASE("InlineBuffer allocator that can fit N objects inline",
+          "[functional][allocator][InlineBuffer]") {
+  Provider provider;
+  Fallback fallback(provider);
+  AllocatorUnderTest allocator(fallback);
+
+  std::array<T*, N> allocs;
+  for (std::size_t i = 0; i < N; ++i)
+    allocs[i] = GetPtrOrFail<T>(allocator.Find(SizeOfT));
+
+  SECTION("All objects are neighbors stored within the allocator") {
+    for (std::size_t i = 0; i < N - 1; ++i)
+      REQUIRE(allocs[i] + 1 == allocs[i + 1]);
+
+    auto* self = ToBytePtr(&allocator);
+    REQUIRE(ToBytePtr(allocs.front()) >= self);
+    REQUIRE(ToBytePtr(allocs.back()) < self + sizeof(allocator));
+    REQUIRE_FALSE(fallback.Owns(ToBytePtr(allocs.front())));
+  }
+
+  SECTION("Requests beyond capacity are served by the fallback") {
+    auto* p = GetValueOrFail<std::byte*>(allocator.Find(SizeOfT));
+    REQUIRE(fallback.Owns(p));
+    REQUIRE(allocator.Owns(p));
+
+    SECTION("And returned to it") {
+      REQUIRE(allocator.Return(p).has_value());
+    }
+  }
+
+  SECTION("Returning the most recent object reclaims its space") {
+    REQUIRE(allocator.Return(ToBytePtr(allocs.back())).has_value());
+    REQUIRE(GetPtrOrFail<T>(allocator.Find(SizeOfT)) == allocs.back());
+  }
+
+  SECTION("Returning older objects succeeds without reclaiming space") {
+    REQUIRE(allocator.Return(ToBytePtr(allocs.front())).has_value());
+    REQUIRE(fallback.Owns(GetValueOrFail<std::byte*>(allocator.Find(SizeOfT))));
+  }
+
+  SECTION("Reset clears space") {
+    REQUIRE(allocator.Reset().has_value());
+    REQUIRE(GetPtrOrFail<T>(allocator.Find(SizeOfT)) == allocs.front());
+  }
+
+  SECTION("Reset leaves the fallback alone") {
+    auto* p = GetValueOrFail<std::byte*>(allocator.Find(SizeOfT));
+    REQUIRE(fallback.Owns(p));
+
+    REQUIRE(allocator.Reset().has_value());
+    REQUIRE(fallback.Owns(p));
+    REQUIRE(fallback.Return(p).has_value());
+  }
+}
+
+TEST_CASE("InlineBuffer allocator respects alignment",
+          "[functional][allocator][InlineBuffer]") {
+  Provider provider;
+  Fallback fallback(provider);
+  strategy::InlineBuffer<256, Fallback> allocator(fallback);
+
+  auto* a = GetValueOrFail<std::byte*>(allocator.Find(Layout(1, 8)));
+  auto* b = GetValueOrFail<std::byte*>(allocator.Find(Layout(1, 64)));
+  REQUIRE(AsUint(b) % 64 == 0);
+  REQUIRE(b > a);
+  REQUIRE_FALSE(fallback.Owns(b));
+}
+
+TEST_CASE("InlineBuffer allocator doesn't overflow on huge requests",
+          "[functional][allocator][InlineBuffer]") {
+  Provider provider;
+  Fallback fallback(provider);
+  strategy::InlineBuffer<256, Fallback> allocator(fallback);
+
+  auto* self = ToBytePtr(&allocator);
+  auto* a = GetValueOrFail<std::byte*>(allocator.Find(Layout(8, 8)));
+  REQUIRE(a >= self);
+
+  // |offset| + size wraps around to a small value.
+  auto ptr_or = allocator.Find(Layout(SIZE_MAX - 7, 8));
+  if (ptr_or.has_value()) {
+    std::byte* ptr = ptr_or.value();
+    REQUIRE((ptr < self || ptr >= self + sizeof(allocator)));
+  }
+
+  REQUIRE(GetValueOrFail<std::byte*>(allocator.Find(Layout(8, 8))) == a + 8);
+}
@@ -1,4 +1,5 @@
 #include <algorithm>
+#include <random>
 #include <ranges>
 #include <vector>
 
@@ -6,6 +7,7 @@
 #include "catch2/catch_test_macros.hpp"
 
 #include <allocators/internal/block.hpp>
+#include <allocators/internal/size_tree.hpp>
 #include <allocators/internal/util.hpp>
 
 #include "../util.hpp"
@@ -51,7 +53,7 @@ TEST_CASE("FetchPages", "[internal/platform]") {
 TEST_CASE("ZeroBlock", "[internal/block]") {
   // Basic test that passing in a |nullptr| doesn't crash the process.
   // Of course, there's nothing to assert.
-  ZeroBlock(nullptr);
+  ZeroBlock<BlockHeader>(nullptr);
 
   static constexpr std::size_t kBufferSize = 32;
   static constexpr char kTestChar = 'a';
@@ -79,7 +81,9 @@ TEST_CASE("ZeroBlock", "[internal/block]") {
 
 TEST_CASE("Find Block returns std::nullopt on bad input", "[internal/block]") {
   auto fn =
-      GENERATE(FindBlockByFirstFit, FindBlockByBestFit, FindBlockByWorstFit);
+      GENERATE(FindBlockByFirstFit<BlockHeader>,
+               FindBlockByBestFit<BlockHeader>,
+               FindBlockByWorstFit<BlockHeader>);
 
   REQUIRE(fn(nullptr, 5) == cpp::fail(Failure::HeaderIsNullptr));
   REQUIRE(fn(TestFreeList::FromBlockSizes({3, 5, 3}).AsHeader(), 0) ==
@@ -89,7 +93,9 @@ TEST_CASE("Find Block returns std::nullopt on bad input", "[internal/block]") {
 TEST_CASE("Find Block returns std::nullopt if no minimun size found",
           "[internal/block]") {
   auto fn =
-      GENERATE(FindBlockByFirstFit, FindBlockByBestFit, FindBlockByWorstFit);
+      GENERATE(FindBlockByFirstFit<BlockHeader>,
+               FindBlockByBestFit<BlockHeader>,
+               FindBlockByWorstFit<BlockHeader>);
   auto free_list = TestFreeList::FromBlockSizes({3, 3, 3});
 
   auto actual = fn(free_list.AsHeader(), SizeWithHeader(4));
@@ -142,9 +148,9 @@ TEST_CASE("FindBlockByWorstFit selects header furthest away from size",
 TEST_CASE("FindPriorBlock returns Failable on bad input", "[internal/block]") {
   auto free_list = TestFreeList::FromBlockSizes({3, 4, 5});
 
-  REQUIRE(FindPriorBlock(nullptr, free_list.AsHeader()) ==
+  REQUIRE(FindPriorBlock<BlockHeader>(nullptr, free_list.AsHeader()) ==
           cpp::fail(Failure::HeaderIsNullptr));
-  REQUIRE(FindPriorBlock(free_list.AsHeader(), nullptr) ==
+  REQUIRE(FindPriorBlock<BlockHeader>(free_list.AsHeader(), nullptr) ==
           cpp::fail(Failure::HeaderIsNullptr));
 }
 
@@ -168,7 +174,7 @@ TEST_CASE("FindPriorBlock returns block prior to |block|", "[internal/block]") {
 }
 
 TEST_CASE("SplitBlock returns error on bad input", "[internal/block]") {
-  REQUIRE(SplitBlock(nullptr, 5, kMinimumAlignment) ==
+  REQUIRE(SplitBlock<BlockHeader>(nullptr, 5, kMinimumAlignment) ==
           cpp::fail(Failure::HeaderIsNullptr));
 
   // Allocate singleton free list with large size to ensure no error related
@@ -216,7 +222,8 @@ TEST_CASE("SplitBlock splits blocks using alignment", "[internal/block]") {
 }
 
 TEST_CASE("CoalesceBlock returns Error on bad input", "[internal/block]") {
-  REQUIRE(CoalesceBlock(nullptr) == cpp::fail(Failure::HeaderIsNullptr));
+  REQUIRE(CoalesceBlock<BlockHeader>(nullptr) ==
+          cpp::fail(Failure::HeaderIsNullptr));
 }
 
 TEST_CASE("CoalesceBlock merges all free adjacent blocks", "[internal/block]") {
@@ -245,3 +252,156 @@ TEST_CASE("CoalesceBlock doesn't merge if free blocks are not adjacent",
   REQUIRE(header_a->next == header_b);
   REQUIRE(header_a->size == kBlockSize + GetBlockHeaderSize());
 }
+
+TEST_CASE("CompactBlockHeader packs size and next into 8 bytes",
+          "[internal/block]") {
+  REQUIRE(GetBlockHeaderSize<CompactBlockHeader>() == 8);
+
+  auto free_list = CompactTestFreeList::FromBlockSizes({8, 16, 8});
+  CompactBlockHeader* header = free_list.AsHeader();
+  REQUIRE(header->GetSize() == SizeWithHeader<CompactBlockHeader>(8));
+  REQUIRE(header->GetNext() == free_list.GetHeader(1));
+  REQUIRE(free_list.GetHeader(2)->GetNext() == nullptr);
+
+  // Links may point backwards as well.
+  free_list.GetHeader(2)->SetNext(header);
+  REQUIRE(free_list.GetHeader(2)->GetNext() == header);
+}
+
+TEST_CASE("Find Block works on compact headers", "[internal/block]") {
+  auto free_list = CompactTestFreeList::FromBlockSizes({8, 24, 16});
+  std::size_t size = SizeWithHeader<CompactBlockHeader>(16);
+
+  auto first_fit = FindBlockByFirstFit(free_list.AsHeader(), size);
+  REQUIRE(first_fit.has_value());
+  REQUIRE(first_fit.value()->header == free_list.GetHeader(1));
+  REQUIRE(first_fit.value()->prev == free_list.GetHeader(0));
+
+  auto best_fit = FindBlockByBestFit(free_list.AsHeader(), size);
+  REQUIRE(best_fit.has_value());
+  REQUIRE(best_fit.value()->header == free_list.GetHeader(2));
+  REQUIRE(best_fit.value()->prev == free_list.GetHeader(1));
+
+  auto worst_fit = FindBlockByWorstFit(free_list.AsHeader(), size);
+  REQUIRE(worst_fit.has_value());
+  REQUIRE(worst_fit.value()->header == free_list.GetHeader(1));
+}
+
+TEST_CASE("SplitBlock and CoalesceBlock work on compact headers",
+          "[internal/block]") {
+  std::size_t kAlignment = 8;
+  std::size_t kBlockSize = 16;
+  std::size_t kHeaderSize = GetBlockHeaderSize<CompactBlockHeader>();
+
+  auto free_list =
+      CompactTestFreeList::FromBlockSizes({kBlockSize * 2 + kHeaderSize});
+  CompactBlockHeader* header = free_list.AsHeader();
+
+  auto split_or = SplitBlock(header, kBlockSize + kHeaderSize, kAlignment);
+  REQUIRE(split_or.has_value());
+  CompactBlockHeader* split = split_or.value();
+  REQUIRE(AsBytePtr(split) == AsBytePtr(header) + kBlockSize + kHeaderSize);
+  REQUIRE(header->GetSize() == kBlockSize + kHeaderSize);
+  REQUIRE(header->GetNext() == split);
+  REQUIRE(split->GetSize() == kBlockSize + kHeaderSize);
+  REQUIRE(split->GetNext() == nullptr);
+
+  REQUIRE(CoalesceBlock(header).has_value());
+  REQUIRE(header->GetSize() == 2 * kBlockSize + 2 * kHeaderSize);
+  REQUIRE(header->GetNext() == nullptr);
+}
+
+TEST_CASE("SortBlocksByAddress orders any list of blocks", "[internal/block]") {
+  REQUIRE(SortBlocksByAddress<BlockHeader>(nullptr) == nullptr);
+
+  std::vector<std::size_t> sizes(50, 16);
+  auto free_list = TestFreeList::FromBlockSizes(sizes);
+  std::vector<std::size_t> order(sizes.size());
+  for (std::size_t i = 0; i < order.size(); ++i)
+    order[i] = i;
+  std::mt19937 engine(std::random_device{}());
+  std::shuffle(order.begin(), order.end(), engine);
+
+  for (std::size_t i = 0; i < order.size(); ++i)
+    free_list.GetHeader(order[i])->SetNext(
+        i + 1 < order.size() ? free_list.GetHeader(order[i + 1]) : nullptr);
+
+  BlockHeader* head = SortBlocksByAddress(free_list.GetHeader(order[0]));
+  for (std::size_t i = 0; i < sizes.size(); ++i) {
+    REQUIRE(head == free_list.GetHeader(i));
+    head = head->GetNext();
+  }
+  REQUIRE(head == nullptr);
+}
+
+TEST_CASE("SizeTree orders blocks by size, then address",
+          "[internal/size_tree]") {
+  auto free_list = TestFreeList::FromBlockSizes({64, 128, 32, 64, 96});
+  auto size_of = [](std::size_t size) { return SizeWithHeader(size); };
+
+  SizeTree<BlockHeader, int> tree;
+  REQUIRE(tree.IsEmpty());
+  REQUIRE(tree.LowerBound(0) == nullptr);
+  REQUIRE(tree.Max() == nullptr);
+
+  for (int i = 0; i < 5; ++i)
+    tree.Insert(free_list.GetHeader(i), i);
+
+  REQUIRE(!tree.IsEmpty());
+  REQUIRE(tree.LowerBound(size_of(16)) == free_list.GetHeader(2));
+  REQUIRE(tree.LowerBound(size_of(33)) == free_list.GetHeader(0));
+  REQUIRE(tree.LowerBound(size_of(65)) == free_list.GetHeader(4));
+  REQUIRE(tree.LowerBound(size_of(129)) == nullptr);
+  REQUIRE(tree.Max() == free_list.GetHeader(1));
+  REQUIRE(SizeTree<BlockHeader, int>::GetData(free_list.GetHeader(3)) == 3);
+
+  SECTION("Erasing a block leaves the others in order") {
+    tree.Erase(free_list.GetHeader(0));
+    REQUIRE(tree.LowerBound(size_of(33)) == free_list.GetHeader(3));
+
+    tree.Erase(free_list.GetHeader(1));
+    REQUIRE(tree.Max() == free_list.GetHeader(4));
+
+    tree.Erase(free_list.GetHeader(2));
+    tree.Erase(free_list.GetHeader(3));
+    tree.Erase(free_list.GetHeader(4));
+    REQUIRE(tree.IsEmpty());
+  }
+
+  SECTION("Clearing drops every block") {
+    tree.Clear();
+    REQUIRE(tree.IsEmpty());
+    REQUIRE(tree.LowerBound(0) == nullptr);
+  }
+}
+
+TEST_CASE("SizeTree matches a linear best-fit search", "[internal/size_tree]") {
+  std::vector<std::size_t> sizes;
+  for (int i = 0; i < 200; ++i)
+    sizes.push_back(32 + 8 * GetRandomNumber<std::size_t>(0, 64));
+
+  auto free_list = TestFreeList::FromBlockSizes(sizes);
+  SizeTree<BlockHeader, int> tree;
+  std::vector<BlockHeader*> in_tree;
+  for (std::size_t i = 0; i < sizes.size(); ++i) {
+    tree.Insert(free_list.GetHeader(i), 0);
+    in_tree.push_back(free_list.GetHeader(i));
+  }
+
+  while (!in_tree.empty()) {
+    std::size_t size = SizeWithHeader(GetRandomNumber<std::size_t>(0, 560));
+    BlockHeader* expected = nullptr;
+    for (BlockHeader* header : in_tree)
+      if (header->GetSize() >= size &&
+          (expected == nullptr || header->GetSize() < expected->GetSize()))
+        expected = header;
+
+    REQUIRE(tree.LowerBound(size) == expected);
+
+    std::size_t index = GetRandomNumber<std::size_t>(0, in_tree.size() - 1);
+    tree.Erase(in_tree[index]);
+    in_tree.erase(in_tree.begin() + index);
+  }
+
+  REQUIRE(tree.IsEmpty());
+}
@@ -0,0 +1,118 @@
+#include "catch2/catch_all.hpp"
+
+#include <memory>
+#include <memory_resource>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include <allocators/adapter/memory_resource.hpp>
+#include <allocators/provider/lock_free_page.hpp>
+#include <allocators/provider/static.hpp>
+#include <allocators/provider/unsynchronized_page.hpp>
+#include <allocators/strategy/freelist.hpp>
+#include <allocators/strategy/lock_free_bump.hpp>
+
+#include "../util.hpp"
+
+using namespace allocators;
+
+using T = long;
+
+using Provider = provider::LockFreePage<>;
+
+TEST_CASE("MemoryResource forwards to strategies",
+          "[functional][allocator][MemoryResource]") {
+  Provider provider;
+  strategy::FreeList<Provider> strategy(provider);
+  adapter::MemoryResource resource(strategy);
+
+  void* p = resource.allocate(sizeof(T), alignof(T));
+  REQUIRE(strategy.Owns(static_cast<std::byte*>(p)));
+  resource.deallocate(p, sizeof(T), alignof(T));
+
+  SECTION("Resources are equal only to themselves") {
+    strategy::FreeList<Provider> other_strategy(provider);
+    adapter::MemoryResource other(other_strategy);
+
+    REQUIRE(resource.is_equal(resource));
+    REQUIRE_FALSE(resource.is_equal(other));
+  }
+
+  SECTION("Failed allocations throw") {
+    REQUIRE_THROWS_AS(resource.allocate(Provider::GetBlockSize()),
+                      std::bad_alloc);
+  }
+
+  SECTION("Works with std::pmr containers") {
+    std::pmr::vector<T> values(&resource);
+    for (T i = 0; i < 100; ++i)
+      values.push_back(i);
+
+    for (T i = 0; i < 100; ++i)
+      REQUIRE(values[i] == i);
+  }
+}
+
+TEST_CASE("MemoryResource works with strategies that don't support returns",
+          "[functional][allocator][MemoryResource]") {
+  Provider provider;
+  strategy::LockFreeBump<Provider> strategy(provider);
+  adapter::MemoryResource resource(strategy);
+
+  std::pmr::unordered_map<T, std::pmr::string> values(&resource);
+  for (T i = 0; i < 100; ++i)
+    values[i] = std::pmr::string(64, 'a');
+
+  REQUIRE(values.size() == 100);
+  REQUIRE(values.at(50).size() == 64);
+}
+
+TEST_CASE("MemoryResource forwards to providers",
+          "[functional][provider][MemoryResource]") {
+  provider::UnsynchronizedPage<> provider;
+  adapter::MemoryResource resource(provider);
+
+  // Requests are rounded up to whole blocks.
+  void* p = resource.allocate(provider.GetBlockSize() + 1);
+  std::fill_n(static_cast<char*>(p), 2 * provider.GetBlockSize(), 'a');
+  resource.deallocate(p, provider.GetBlockSize() + 1);
+
+  SECTION("But not alignments larger than a block") {
+    REQUIRE_THROWS_AS(resource.allocate(1, 2 * provider.GetBlockSize()),
+                      std::bad_alloc);
+  }
+}
+
+TEST_CASE("MemoryResource checks the alignment of provided blocks",
+          "[functional][provider][MemoryResource]") {
+  static constexpr std::size_t kBlockSize = 1024;
+
+  // |provider::Static| only aligns its block to |alignof(max_align_t)|. Offset
+  // it so that the block is never aligned to 64 bytes.
+  struct alignas(64) Misaligned {
+    std::byte padding[alignof(std::max_align_t)];
+    provider::Static<kBlockSize> provider;
+  };
+
+  auto misaligned = std::make_unique<Misaligned>();
+  adapter::MemoryResource resource(misaligned->provider);
+
+  REQUIRE_THROWS_AS(resource.allocate(1, 64), std::bad_alloc);
+
+  void* p = resource.allocate(1, alignof(std::max_align_t));
+  REQUIRE(p != nullptr);
+  resource.deallocate(p, 1, alignof(std::max_align_t));
+}
+
+TEST_CASE("MemoryResource can't span blocks of single-block providers",
+          "[functional][provider][MemoryResource]") {
+  Provider provider;
+  adapter::MemoryResource resource(provider);
+
+  void* p = resource.allocate(provider.GetBlockSize());
+  resource.deallocate(p, provider.GetBlockSize());
+
+  REQUIRE_THROWS_AS(resource.allocate(provider.GetBlockSize() + 1),
+                    std::bad_alloc);
+}
@@ -1,10 +1,16 @@
 #include "catch2/catch_all.hpp"
 
+#include <algorithm>
 #include <array>
+#include <vector>
+
+#include <sys/mman.h>
 
 #include <allocators/provider/lock_free_page.hpp>
 #include <allocators/provider/unsynchronized_page.hpp>
 
+#include "../util.hpp"
+
 using namespace allocators;
 
 static constexpr std::size_t kPageSize = 4096;
@@ -12,8 +18,13 @@ static constexpr std::uint64_t kMaxPages = (1 << 18) - 1;
 
 template <class... Allocator> struct AllocatorPack {};
 
+using CachingPage = provider::UnsynchronizedPage<
+    provider::UnsynchronizedPageParams::ChunkT<64>,
+    provider::UnsynchronizedPageParams::CacheT<256>>;
+
 using AllocatorsUnderTest =
-    AllocatorPack<provider::LockFreePage<>, provider::UnsynchronizedPage<>>;
+    AllocatorPack<provider::LockFreePage<>, provider::UnsynchronizedPage<>,
+                  CachingPage>;
 
 TEMPLATE_LIST_TEST_CASE("Page allocator", "[functional][allocator][Page]",
                         AllocatorsUnderTest) {
@@ -44,6 +55,29 @@ TEMPLATE_LIST_TEST_CASE("Page allocator", "[functional][allocator][Page]",
     }
   }
 
+  SECTION("Can provide and return pages in batches") {
+    static constexpr std::size_t kBatchSize = 64;
+
+    AllocatorUnderTest allocator;
+    std::array<std::byte*, kBatchSize> batch = {};
+    REQUIRE(allocator.ProvideBatch(batch).has_value());
+
+    std::sort(batch.begin(), batch.end());
+    REQUIRE(std::adjacent_find(batch.begin(), batch.end()) == batch.end());
+    for (std::byte* p : batch) {
+      REQUIRE(p != nullptr);
+      p[0] = p[kPageSize - 1] = std::byte(1);
+    }
+
+    REQUIRE(allocator.ReturnBatch(batch).has_value());
+
+    SECTION("Reusing returned pages") {
+      std::array<std::byte*, kBatchSize> reused = {};
+      REQUIRE(allocator.ProvideBatch(reused).has_value());
+      REQUIRE(allocator.ReturnBatch(reused).has_value());
+    }
+  }
+
   // TODO: Support multiples pages per request.
   SECTION("Can allocator multiple pages per request") {}
 
@@ -56,3 +90,139 @@ TEMPLATE_LIST_TEST_CASE("Page allocator", "[functional][allocator][Page]",
     }
   }
 }
+
+TEST_CASE("Page allocator grows one super block at a time",
+          "[functional][allocator][Page]") {
+  using Params = provider::LockFreePageParams;
+  static constexpr std::size_t kLimit = 100;
+  static constexpr std::size_t kSuperBlockPages = 16;
+
+  provider::LockFreePage<Params::LimitT<kLimit>,
+                         Params::SuperBlockT<kSuperBlockPages>>
+      allocator;
+
+  SECTION("Provides pages up to the limit") {
+    std::vector<std::byte*> allocations;
+    for (auto i = 0u; i < kLimit; ++i) {
+      auto p_or = allocator.Provide(1);
+      REQUIRE(p_or.has_value());
+      p_or.value()[kPageSize - 1] = std::byte(1);
+      allocations.push_back(p_or.value());
+    }
+
+    auto p_or = allocator.Provide(1);
+    REQUIRE(p_or.has_error());
+    REQUIRE(p_or.error() == Error::NoFreeBlock);
+
+    std::sort(allocations.begin(), allocations.end());
+    REQUIRE(std::adjacent_find(allocations.begin(), allocations.end()) ==
+            allocations.end());
+
+    // Batches may span super blocks on return.
+    REQUIRE(allocator.ReturnBatch(allocations).has_value());
+    REQUIRE(allocator.Provide(1).has_value());
+  }
+
+  SECTION("Takes a batch out of a single super block") {
+    std::array<std::byte*, kSuperBlockPages> batch = {};
+    REQUIRE(allocator.ProvideBatch(batch).has_value());
+    REQUIRE(allocator.ProvideBatch(batch).has_value());
+
+    std::array<std::byte*, kSuperBlockPages + 1> too_large = {};
+    REQUIRE(allocator.ProvideBatch(too_large).error() == Error::InvalidInput);
+  }
+
+  SECTION("Rejects pages it didn't provide") {
+    std::byte page[kPageSize];
+    REQUIRE(allocator.Return(page).error() == Error::InvalidInput);
+
+    std::byte* p = GetValueOrFail(allocator.Provide(1));
+    std::byte* q = GetValueOrFail(allocator.Provide(1));
+    REQUIRE(allocator.Return(page).error() == Error::InvalidInput);
+
+    SECTION("Or that were already returned") {
+      REQUIRE(allocator.Return(p).has_value());
+      REQUIRE(allocator.Return(p).error() == Error::InvalidInput);
+
+      std::array<std::byte*, 2> batch = {q, p};
+      REQUIRE(allocator.ReturnBatch(batch).error() == Error::InvalidInput);
+      REQUIRE(allocator.Return(q).has_value());
+    }
+  }
+}
+
+// Whether all |count| pages at |ptr| are mapped.
+static bool IsMapped(std::byte* ptr, std::size_t count) {
+  std::vector<unsigned char> residency(count);
+  return mincore(ptr, count * kPageSize, residency.data()) == 0;
+}
+
+TEST_CASE("Page allocator carves and caches ranges",
+          "[functional][allocator][Page]") {
+  using Params = provider::UnsynchronizedPageParams;
+
+  SECTION("Carves neighboring ranges out of a chunk") {
+    provider::UnsynchronizedPage<Params::ChunkT<16>> allocator;
+    static_assert(ZeroedProviderTrait<decltype(allocator)>);
+
+    std::byte* a = GetValueOrFail(allocator.Provide(4));
+    std::byte* b = GetValueOrFail(allocator.Provide(12));
+    REQUIRE(b == a + 4 * kPageSize);
+
+    // The first chunk is used up, so these come from a new one.
+    std::byte* c = GetValueOrFail(allocator.Provide(1));
+    std::byte* d = GetValueOrFail(allocator.Provide(1));
+    REQUIRE(d == c + kPageSize);
+
+    // Doesn't fit in any chunk.
+    std::byte* e = GetValueOrFail(allocator.Provide(32));
+    e[32 * kPageSize - 1] = std::byte(1);
+
+    for (std::byte* p : {a, b, c, d, e})
+      REQUIRE(allocator.Return(p).has_value());
+  }
+
+  SECTION("Reuses returned ranges of the same size") {
+    provider::UnsynchronizedPage<Params::CacheT<8>> allocator;
+    static_assert(!ZeroedProviderTrait<decltype(allocator)>);
+
+    std::byte* a = GetValueOrFail(allocator.Provide(2));
+    std::byte* b = GetValueOrFail(allocator.Provide(4));
+    a[2 * kPageSize - 1] = std::byte(1);
+    REQUIRE(allocator.Return(a).has_value());
+    REQUIRE(allocator.Return(b).has_value());
+
+    REQUIRE(GetValueOrFail(allocator.Provide(4)) == b);
+    REQUIRE(GetValueOrFail(allocator.Provide(2)) == a);
+    REQUIRE(a[2 * kPageSize - 1] == std::byte(1));
+    REQUIRE(allocator.Return(a).has_value());
+    REQUIRE(allocator.Return(b).has_value());
+    REQUIRE(allocator.Return(a).error() == Error::InvalidInput);
+
+    SECTION("Up to the size of the cache") {
+      // Only 2 of the 8 pages are left, so |c| gets unmapped, and whatever
+      // comes next is a fresh mapping.
+      std::byte* c = GetValueOrFail(allocator.Provide(3));
+      c[0] = std::byte(1);
+      REQUIRE(allocator.Return(c).has_value());
+      REQUIRE(GetValueOrFail(allocator.Provide(3))[0] == std::byte(0));
+    }
+  }
+
+  SECTION("Unmaps cached ranges and the chunk when destroyed") {
+    std::byte* cached = nullptr;
+    std::byte* tail = nullptr;
+    {
+      provider::UnsynchronizedPage<Params::ChunkT<16>, Params::CacheT<8>>
+          allocator;
+      cached = GetValueOrFail(allocator.Provide(2));
+      tail = GetValueOrFail(allocator.Provide(1)) + kPageSize;
+      REQUIRE(allocator.Return(cached).has_value());
+      REQUIRE(IsMapped(cached, 2));
+      REQUIRE(IsMapped(tail, 13));
+    }
+
+    REQUIRE_FALSE(IsMapped(cached, 2));
+    REQUIRE_FALSE(IsMapped(tail, 13));
+  }
+}
@@ -0,0 +1,108 @@
+#include "catch2/catch_all.hpp"
+
+#include <cstring>
+#include <tuple>
+
+#include <allocators/provider/lock_free_page.hpp>
+#include <allocators/strategy/freelist.hpp>
+#include <allocators/strategy/lock_free_bump.hpp>
+#include <allocators/strategy/stack.hpp>
+
+#include "../util.hpp"
+
+using namespace allocators;
+
+using Provider = provider::LockFreePage<>;
+
+using ResizableStrategies =
+    std::tuple<strategy::FreeList<Provider>, strategy::LockFreeBump<Provider>,
+               strategy::Stack<Provider>>;
+
+static_assert(ResizeTrait<strategy::FreeList<Provider>>);
+static_assert(ResizeTrait<strategy::LockFreeBump<Provider>>);
+static_assert(ResizeTrait<strategy::Stack<Provider>>);
+
+TEMPLATE_LIST_TEST_CASE("Most recent allocation can be resized in place",
+                        "[functional][allocator][Resize]",
+                        ResizableStrategies) {
+  static constexpr std::size_t kSize = 64;
+
+  Provider provider;
+  TestType strategy(provider);
+
+  std::byte* p = GetValueOrFail<std::byte*>(strategy.Find(kSize));
+  std::memset(p, 0xAB, kSize);
+
+  SECTION("Growing keeps pointer and contents") {
+    REQUIRE(strategy.Resize(p, Layout(4 * kSize, 8)).has_value());
+    for (std::size_t i = 0; i < kSize; ++i)
+      REQUIRE(p[i] == std::byte{0xAB});
+
+    std::memset(p, 0xCD, 4 * kSize);
+  }
+
+  SECTION("Shrinking keeps pointer and contents") {
+    REQUIRE(strategy.Resize(p, Layout(kSize / 2, 8)).has_value());
+    for (std::size_t i = 0; i < kSize / 2; ++i)
+      REQUIRE(p[i] == std::byte{0xAB});
+  }
+
+  SECTION("But can't grow past the size of a block") {
+    REQUIRE(strategy.Resize(p, Layout(provider.GetBlockSize() + 1, 8)) ==
+            cpp::fail(Error::NoFreeBlock));
+  }
+
+  SECTION("But can't resize null pointer") {
+    REQUIRE(strategy.Resize(nullptr, Layout(kSize, 8)) ==
+            cpp::fail(Error::InvalidInput));
+  }
+}
+
+TEST_CASE("Bump allocator can only resize most recent allocation",
+          "[functional][allocator][Resize][LockFreeBump]") {
+  Provider provider;
+  strategy::LockFreeBump<Provider> strategy(provider);
+
+  std::byte* first = GetValueOrFail<std::byte*>(strategy.Find(64));
+  std::byte* second = GetValueOrFail<std::byte*>(strategy.Find(64));
+
+  REQUIRE(strategy.Resize(first, Layout(128, 8)) ==
+          cpp::fail(Error::NoFreeBlock));
+
+  SECTION("Growing moves subsequent allocations") {
+    REQUIRE(strategy.Resize(second, Layout(128, 8)).has_value());
+    REQUIRE(GetValueOrFail<std::byte*>(strategy.Find(8)) == second + 128);
+  }
+}
+
+TEST_CASE("FreeList allocator grows into free neighbor",
+          "[functional][allocator][Resize][FreeList]") {
+  Provider provider;
+  strategy::FreeList<Provider, strategy::FreeListParams::SearchT<
+                                   strategy::FreeListParams::FirstFit>>
+      strategy(provider);
+
+  std::byte* first = GetValueOrFail<std::byte*>(strategy.Find(64));
+  std::byte* second = GetValueOrFail<std::byte*>(strategy.Find(64));
+  std::byte* third = GetValueOrFail<std::byte*>(strategy.Find(64));
+
+  SECTION("But not if the neighbor is allocated") {
+    REQUIRE(strategy.Resize(first, Layout(128, 8)) ==
+            cpp::fail(Error::NoFreeBlock));
+  }
+
+  SECTION("Once the neighbor is returned") {
+    REQUIRE(strategy.Return(second).has_value());
+    REQUIRE(strategy.Resize(first, Layout(128, 8)).has_value());
+
+    SECTION("But not past it") {
+      REQUIRE(strategy.Resize(first, Layout(256, 8)) ==
+              cpp::fail(Error::NoFreeBlock));
+    }
+
+    SECTION("Giving back the space on shrink") {
+      REQUIRE(strategy.Resize(first, Layout(16, 8)).has_value());
+      REQUIRE(GetValueOrFail<std::byte*>(strategy.Find(64)) < third);
+    }
+  }
+}
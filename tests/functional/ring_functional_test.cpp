@@ -0,0 +1,114 @@
+#include "catch2/catch_all.hpp"
+
+#include <array>
+#include <vector>
+
+#include <allocators/provider/lock_free_page.hpp>
+#include <allocators/provider/static.hpp>
+#include <allocators/strategy/ring.hpp>
+
+#include "../util.hpp"
+
+using namespace allocators;
+
+using T = long;
+static constexpr std::size_t SizeOfT = sizeof(T);
+// Each allocation of |T| takes up a 16-byte header and 16 bytes of storage.
+static constexpr std::size_t kRecordSize = 32;
+static constexpr std::size_t kBlockSize = 1024;
+static constexpr std::size_t N = kBlockSize / kRecordSize;
+
+template <class... Allocator> struct AllocatorPack {};
+
+using Provider = provider::Static<kBlockSize>;
+
+using AllocatorsUnderTest = AllocatorPack<
+    strategy::Ring<Provider>,
+    strategy::Ring<Provider, strategy::RingParams::ProducersT<
+                                 strategy::RingParams::Producers::Multiple>>>;
+
+TEMPLATE_LIST_TEST_CASE("Ring allocator that can fit N objects",
+                        "[functional][allocator][Ring]", AllocatorsUnderTest) {
+  Provider provider;
+  TestType allocator(provider);
+
+  std::array<T*, N> allocs;
+  for (std::size_t i = 0; i < N; ++i)
+    allocs[i] = GetPtrOrFail<T>(allocator.Find(SizeOfT));
+
+  SECTION("All objects are laid out in order") {
+    for (std::size_t i = 0; i < N - 1; ++i)
+      REQUIRE(ToBytePtr(allocs[i]) + kRecordSize == ToBytePtr(allocs[i + 1]));
+  }
+
+  SECTION("Can not allocate more objects when at capacity") {
+    REQUIRE(allocator.Find(SizeOfT) == cpp::fail(Error::NoFreeBlock));
+  }
+
+  SECTION("Returning the oldest object frees space at the front") {
+    REQUIRE(allocator.Return(ToBytePtr(allocs.front())).has_value());
+    REQUIRE(GetPtrOrFail<T>(allocator.Find(SizeOfT)) == allocs.front());
+  }
+
+  SECTION("Returning a newer object doesn't free space until older ones are") {
+    REQUIRE(allocator.Return(ToBytePtr(allocs[1])).has_value());
+    REQUIRE(allocator.Find(SizeOfT) == cpp::fail(Error::NoFreeBlock));
+
+    REQUIRE(allocator.Return(ToBytePtr(allocs[0])).has_value());
+    REQUIRE(GetPtrOrFail<T>(allocator.Find(SizeOfT)) == allocs[0]);
+    REQUIRE(GetPtrOrFail<T>(allocator.Find(SizeOfT)) == allocs[1]);
+  }
+
+  SECTION("Returning an object twice fails") {
+    REQUIRE(allocator.Return(ToBytePtr(allocs.front())).has_value());
+    REQUIRE(allocator.Return(ToBytePtr(allocs.front())) ==
+            cpp::fail(Error::InvalidInput));
+  }
+
+  SECTION("Objects can be allocated and returned indefinitely in FIFO order") {
+    for (std::size_t i = 0; i < 10 * N; ++i) {
+      REQUIRE(allocator.Return(ToBytePtr(allocs[i % N])).has_value());
+      allocs[i % N] = GetPtrOrFail<T>(allocator.Find(SizeOfT));
+    }
+  }
+
+  SECTION("Reset clears space") {
+    REQUIRE(allocator.Reset().has_value());
+
+    SECTION("Allowing subsequent requests") {
+      for (std::size_t i = 0; i < N; ++i)
+        allocs[i] = GetPtrOrFail<T>(allocator.Find(SizeOfT));
+    }
+  }
+}
+
+TEST_CASE("Ring allocator wraps around the end of its span",
+          "[functional][allocator][Ring]") {
+  provider::LockFreePage<> provider;
+  strategy::Ring<provider::LockFreePage<>> allocator(provider);
+
+  std::size_t capacity = provider.GetBlockSize();
+  std::size_t request_size = capacity / 3;
+
+  std::vector<std::byte*> allocs;
+  for (std::size_t i = 0; i < 2; ++i)
+    allocs.push_back(GetValueOrFail<std::byte*>(allocator.Find(request_size)));
+
+  REQUIRE(allocator.Return(allocs[0]).has_value());
+
+  // The remainder of the span can't fit another request, so it wraps around
+  // to the front.
+  auto* wrapped = GetValueOrFail<std::byte*>(allocator.Find(request_size));
+  REQUIRE(wrapped < allocs[0] + request_size);
+
+  SECTION("And respects alignment after wrapping") {
+    REQUIRE(allocator.Return(allocs[1]).has_value());
+    auto* aligned =
+        GetValueOrFail<std::byte*>(allocator.Find(Layout(1, 256)));
+    REQUIRE(AsUint(aligned) % 256 == 0);
+  }
+
+  SECTION("But can't fit request size larger than span") {
+    REQUIRE(allocator.Find(capacity) == cpp::fail(Error::SizeRequestTooLarge));
+  }
+}
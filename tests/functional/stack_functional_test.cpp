@@ -0,0 +1,92 @@
+#include "catch2/catch_all.hpp"
+
+#include <array>
+#include <vector>
+
+#include <allocators/provider/lock_free_page.hpp>
+#include <allocators/strategy/stack.hpp>
+
+#include "../util.hpp"
+
+using namespace allocators;
+
+using T = long;
+static constexpr std::size_t SizeOfT = sizeof(T);
+static constexpr std::size_t N = 10;
+
+using AllocatorUnderTest = strategy::Stack<provider::LockFreePage<>>;
+
+TEST_CASE("Stack allocator pops allocations in LIFO order",
+          "[functional][allocator][Stack]") {
+  provider::LockFreePage<> provider;
+  AllocatorUnderTest allocator(provider);
+
+  std::array<T*, N> allocs;
+  for (std::size_t i = 0; i < N; ++i)
+    allocs[i] = GetPtrOrFail<T>(allocator.Find(SizeOfT));
+
+  SECTION("Only the most recent allocation can be returned") {
+    REQUIRE(allocator.Return(ToBytePtr(allocs.front())) ==
+            cpp::fail(Error::InvalidInput));
+  }
+
+  SECTION("Returning the most recent allocation reuses its space") {
+    REQUIRE(allocator.Return(ToBytePtr(allocs.back())).has_value());
+    REQUIRE(GetPtrOrFail<T>(allocator.Find(SizeOfT)) == allocs.back());
+  }
+
+  SECTION("All allocations can be returned in reverse order") {
+    for (std::size_t i = N; i > 0; --i)
+      REQUIRE(allocator.Return(ToBytePtr(allocs[i - 1])).has_value());
+
+    REQUIRE(GetPtrOrFail<T>(allocator.Find(SizeOfT)) == allocs.front());
+  }
+
+  SECTION("Reset clears space") {
+    REQUIRE(allocator.Reset().has_value());
+    REQUIRE(allocator.Return(ToBytePtr(allocs.back())) ==
+            cpp::fail(Error::InvalidInput));
+  }
+}
+
+TEST_CASE("Stack allocator respects alignment",
+          "[functional][allocator][Stack]") {
+  provider::LockFreePage<> provider;
+  AllocatorUnderTest allocator(provider);
+
+  for (std::size_t alignment : {8ul, 16ul, 64ul, 256ul}) {
+    auto* p = GetValueOrFail<std::byte*>(allocator.Find(Layout(1, alignment)));
+    REQUIRE(AsUint(p) % alignment == 0);
+  }
+}
+
+TEST_CASE("Stack allocator spans multiple blocks",
+          "[functional][allocator][Stack]") {
+  static constexpr std::size_t kRequestSize = 1024;
+
+  provider::LockFreePage<> provider;
+  AllocatorUnderTest allocator(provider);
+
+  // Enough requests to fill several blocks.
+  std::vector<std::byte*> allocs;
+  for (std::size_t i = 0; i < 4 * N; ++i)
+    allocs.push_back(GetValueOrFail<std::byte*>(allocator.Find(kRequestSize)));
+
+  SECTION("And can pop back across block boundaries") {
+    while (!allocs.empty()) {
+      REQUIRE(allocator.Return(allocs.back()).has_value());
+      allocs.pop_back();
+    }
+  }
+
+  SECTION("And reuses the cached block after popping past a boundary") {
+    std::byte* last = allocs.back();
+    REQUIRE(allocator.Return(last).has_value());
+    REQUIRE(GetValueOrFail<std::byte*>(allocator.Find(kRequestSize)) == last);
+  }
+
+  SECTION("But can't fit request size larger than block size") {
+    REQUIRE(allocator.Find(provider.GetBlockSize()) ==
+            cpp::fail(Error::SizeRequestTooLarge));
+  }
+}
@@ -0,0 +1,265 @@
+// Tests for liballocators_malloc.so. They're meant to run with the library
+// preloaded, i.e. with LD_PRELOAD set to it, so that every call below goes
+// through the replacement.
+
+#include "catch2/catch_all.hpp"
+
+#include <atomic>
+#include <cerrno>
+#include <cstddef>
+#include <cstdint>
+#include <cstdlib>
+#include <cstring>
+#include <string_view>
+#include <thread>
+#include <vector>
+
+#include <dlfcn.h>
+#include <malloc.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+// Largest request served from an arena by the replacement. Anything larger is
+// mapped directly.
+static constexpr std::size_t kMaxArenaRequest = 256 * 1024;
+
+static bool IsAligned(void* ptr, std::size_t alignment) {
+  return reinterpret_cast<std::uintptr_t>(ptr) % alignment == 0;
+}
+
+// Fill |size| bytes at |ptr| with a pattern derived from |seed|.
+static void Fill(void* ptr, std::size_t size, unsigned char seed) {
+  auto* bytes = static_cast<unsigned char*>(ptr);
+  for (std::size_t i = 0; i < size; ++i)
+    bytes[i] = static_cast<unsigned char>(seed + i);
+}
+
+// Whether the |size| bytes at |ptr| hold the pattern written by |Fill|.
+static bool HasPattern(void* ptr, std::size_t size, unsigned char seed) {
+  auto* bytes = static_cast<unsigned char*>(ptr);
+  for (std::size_t i = 0; i < size; ++i)
+    if (bytes[i] != static_cast<unsigned char>(seed + i))
+      return false;
+
+  return true;
+}
+
+static bool IsZeroed(void* ptr, std::size_t size) {
+  auto* bytes = static_cast<unsigned char*>(ptr);
+  for (std::size_t i = 0; i < size; ++i)
+    if (bytes[i] != 0)
+      return false;
+
+  return true;
+}
+
+TEST_CASE("malloc resolves to the replacement", "[malloc]") {
+  Dl_info info;
+  REQUIRE(dladdr(dlsym(RTLD_DEFAULT, "malloc"), &info) != 0);
+  REQUIRE(info.dli_fname != nullptr);
+  REQUIRE(std::string_view(info.dli_fname).find("allocators_malloc") !=
+          std::string_view::npos);
+}
+
+TEST_CASE("malloc and malloc_usable_size", "[malloc]") {
+  for (std::size_t size : {std::size_t(1), std::size_t(24), std::size_t(4096),
+                           kMaxArenaRequest, kMaxArenaRequest + 1,
+                           std::size_t(4 << 20)}) {
+    void* ptr = malloc(size);
+    REQUIRE(ptr != nullptr);
+    REQUIRE(IsAligned(ptr, alignof(std::max_align_t)));
+    REQUIRE(malloc_usable_size(ptr) >= size);
+
+    Fill(ptr, malloc_usable_size(ptr), 1);
+    REQUIRE(HasPattern(ptr, malloc_usable_size(ptr), 1));
+    free(ptr);
+  }
+
+  REQUIRE(malloc_usable_size(nullptr) == 0);
+}
+
+TEST_CASE("posix_memalign honors the alignment", "[malloc]") {
+  std::size_t size = GENERATE(std::size_t(1), std::size_t(100),
+                              std::size_t(8192), kMaxArenaRequest + 1);
+  std::size_t alignment = GENERATE(std::size_t(16), std::size_t(64),
+                                   std::size_t(4096), std::size_t(8192),
+                                   std::size_t(65536), std::size_t(2 << 20));
+
+  void* ptr = nullptr;
+  REQUIRE(posix_memalign(&ptr, alignment, size) == 0);
+  REQUIRE(ptr != nullptr);
+  REQUIRE(IsAligned(ptr, alignment));
+  REQUIRE(malloc_usable_size(ptr) >= size);
+
+  Fill(ptr, size, 2);
+  REQUIRE(HasPattern(ptr, size, 2));
+  free(ptr);
+}
+
+TEST_CASE("posix_memalign rejects invalid alignments", "[malloc]") {
+  void* ptr = nullptr;
+  REQUIRE(posix_memalign(&ptr, 24, 8) == EINVAL);
+  REQUIRE(posix_memalign(&ptr, 1, 8) == EINVAL);
+}
+
+TEST_CASE("aligned_alloc honors the alignment", "[malloc]") {
+  std::size_t alignment = GENERATE(std::size_t(32), std::size_t(4096),
+                                   std::size_t(8192), std::size_t(65536));
+
+  void* ptr = aligned_alloc(alignment, alignment);
+  REQUIRE(ptr != nullptr);
+  REQUIRE(IsAligned(ptr, alignment));
+
+  Fill(ptr, alignment, 3);
+  REQUIRE(HasPattern(ptr, alignment, 3));
+  free(ptr);
+}
+
+TEST_CASE("operator new honors over-aligned types", "[malloc]") {
+  struct alignas(8192) Page {
+    std::byte bytes[8192];
+  };
+
+  auto* page = new Page;
+  REQUIRE(IsAligned(page, alignof(Page)));
+  delete page;
+
+  auto* pages = new Page[3];
+  REQUIRE(IsAligned(pages, alignof(Page)));
+  delete[] pages;
+}
+
+TEST_CASE("calloc returns zeroed memory", "[malloc]") {
+  std::size_t size =
+      GENERATE(std::size_t(64), std::size_t(4096), kMaxArenaRequest + 1);
+
+  // Dirty memory the arena is likely to hand out again.
+  void* dirty = malloc(size);
+  REQUIRE(dirty != nullptr);
+  std::memset(dirty, 0xff, size);
+  free(dirty);
+
+  void* ptr = calloc(1, size);
+  REQUIRE(ptr != nullptr);
+  REQUIRE(IsZeroed(ptr, size));
+  free(ptr);
+
+  // Kept opaque to the compiler, which rejects an obviously overflowing call.
+  volatile std::size_t count = SIZE_MAX / 2;
+  REQUIRE(calloc(count, 4) == nullptr);
+  REQUIRE(errno == ENOMEM);
+}
+
+TEST_CASE("realloc keeps contents across the arena threshold", "[malloc]") {
+  std::size_t size = 1024;
+  void* ptr = malloc(size);
+  REQUIRE(ptr != nullptr);
+  Fill(ptr, size, 4);
+
+  SECTION("Grows from an arena to a mapping and back") {
+    void* grown = realloc(ptr, 2 * kMaxArenaRequest);
+    REQUIRE(grown != nullptr);
+    REQUIRE(HasPattern(grown, size, 4));
+    REQUIRE(malloc_usable_size(grown) >= 2 * kMaxArenaRequest);
+
+    Fill(grown, 2 * kMaxArenaRequest, 5);
+    void* larger = realloc(grown, 4 * kMaxArenaRequest);
+    REQUIRE(larger != nullptr);
+    REQUIRE(HasPattern(larger, 2 * kMaxArenaRequest, 5));
+
+    void* shrunk = realloc(larger, size);
+    REQUIRE(shrunk != nullptr);
+    REQUIRE(HasPattern(shrunk, size, 5));
+    free(shrunk);
+  }
+
+  SECTION("Grows within an arena") {
+    void* grown = realloc(ptr, kMaxArenaRequest / 2);
+    REQUIRE(grown != nullptr);
+    REQUIRE(HasPattern(grown, size, 4));
+    free(grown);
+  }
+
+  SECTION("Keeps over-aligned mappings intact") {
+    void* aligned = nullptr;
+    REQUIRE(posix_memalign(&aligned, 65536, size) == 0);
+    Fill(aligned, size, 6);
+
+    void* grown = realloc(aligned, 2 * kMaxArenaRequest);
+    REQUIRE(grown != nullptr);
+    REQUIRE(HasPattern(grown, size, 6));
+    free(grown);
+    free(ptr);
+  }
+
+  SECTION("Frees on zero size") { REQUIRE(realloc(ptr, 0) == nullptr); }
+}
+
+TEST_CASE("fork from a multithreaded process", "[malloc]") {
+  constexpr std::size_t kThreads = 4;
+  constexpr std::size_t kForks = 16;
+
+  std::atomic<bool> stop = false;
+  std::vector<std::thread> threads;
+  for (std::size_t i = 0; i < kThreads; ++i) {
+    threads.emplace_back([&stop, i]() {
+      std::size_t size = 16;
+      while (!stop.load(std::memory_order_relaxed)) {
+        void* ptr = malloc(size);
+        Fill(ptr, size, static_cast<unsigned char>(i));
+        free(ptr);
+        size = size < kMaxArenaRequest * 2 ? size * 2 : 16;
+      }
+    });
+  }
+
+  // Checked once every thread is joined, so that a failure doesn't leave them
+  // running.
+  std::size_t failed_forks = 0;
+  for (std::size_t i = 0; i < kForks; ++i) {
+    pid_t pid = fork();
+    if (pid < 0) {
+      ++failed_forks;
+      continue;
+    }
+
+    if (pid == 0) {
+      // Only the forking thread survives. Every arena must still be usable,
+      // including the ones left behind by the other threads.
+      bool ok = true;
+      std::vector<void*> ptrs;
+      for (std::size_t size = 16; size <= kMaxArenaRequest * 2; size *= 2) {
+        void* ptr = malloc(size);
+        ok = ok && ptr != nullptr;
+        if (ptr != nullptr) {
+          Fill(ptr, size, 7);
+          ok = ok && HasPattern(ptr, size, 7);
+          ptrs.push_back(ptr);
+        }
+      }
+
+      for (void* ptr : ptrs)
+        free(ptr);
+
+      std::thread child_thread([&ok]() {
+        void* ptr = malloc(64);
+        ok = ok && ptr != nullptr;
+        free(ptr);
+      });
+      child_thread.join();
+
+      _exit(ok ? 0 : 1);
+    }
+
+    int status = 0;
+    if (waitpid(pid, &status, 0) != pid || !WIFEXITED(status) ||
+        WEXITSTATUS(status) != 0)
+      ++failed_forks;
+  }
+
+  stop = true;
+  for (auto& thread : threads)
+    thread.join();
+
+  REQUIRE(failed_forks == 0);
+}
@@ -40,8 +40,9 @@ template <class T> inline T* GetPtrOrFail(Result<std::byte*> result) {
   return reinterpret_cast<T*>((result.value()));
 }
 
+template <class Header = BlockHeader>
 inline constexpr std::size_t SizeWithHeader(std::size_t sz) {
-  return sz + GetBlockHeaderSize();
+  return sz + GetBlockHeaderSize<Header>();
 }
 
 template <class T> inline T GetRandomNumber(T low, T high) {
@@ -51,12 +52,13 @@ template <class T> inline T GetRandomNumber(T low, T high) {
   return distribution(engine);
 }
 
-class TestFreeList {
+template <class Header> class BasicTestFreeList {
 public:
-  static TestFreeList FromBlockSizes(std::vector<std::size_t> block_sizes) {
+  static BasicTestFreeList
+  FromBlockSizes(std::vector<std::size_t> block_sizes) {
     std::size_t total_size = 0;
     for (auto& bz : block_sizes) {
-      bz += GetBlockHeaderSize();
+      bz += GetBlockHeaderSize<Header>();
       total_size += bz;
     }
 
@@ -65,37 +67,41 @@ public:
     std::byte* itr = buffer.get();
     for (std::size_t i = 0; i < block_sizes.size(); ++i) {
       auto size = block_sizes[i];
-      BlockHeader* h = reinterpret_cast<BlockHeader*>(itr);
-      h->size = size;
+      Header* h = reinterpret_cast<Header*>(itr);
+      h->SetSize(size);
       itr = itr + size;
-      if (i < block_sizes.size() - 1)
-        h->next = reinterpret_cast<BlockHeader*>(itr);
+      h->SetNext(i < block_sizes.size() - 1 ? reinterpret_cast<Header*>(itr)
+                                            : nullptr);
     }
 
-    return TestFreeList(std::move(buffer), std::move(block_sizes));
+    return BasicTestFreeList(std::move(buffer), std::move(block_sizes));
   }
 
-  BlockHeader* AsHeader() {
+  Header* AsHeader() {
     CHECK(buffer_ != nullptr);
-    return reinterpret_cast<BlockHeader*>(buffer_.get());
+    return reinterpret_cast<Header*>(buffer_.get());
   }
 
-  BlockHeader* GetHeader(std::size_t target) {
+  Header* GetHeader(std::size_t target) {
     CHECK(target < block_sizes_.size());
 
     std::size_t offset =
         std::accumulate(begin(block_sizes_), begin(block_sizes_) + target, 0);
 
-    return reinterpret_cast<BlockHeader*>(buffer_.get() + offset);
+    return reinterpret_cast<Header*>(buffer_.get() + offset);
   }
 
 private:
-  TestFreeList() = delete;
+  BasicTestFreeList() = delete;
 
-  TestFreeList(std::unique_ptr<std::byte[]> buffer,
-               std::vector<std::size_t> block_sizes)
+  BasicTestFreeList(std::unique_ptr<std::byte[]> buffer,
+                    std::vector<std::size_t> block_sizes)
       : buffer_(std::move(buffer)), block_sizes_(std::move(block_sizes)) {}
 
   std::vector<std::size_t> block_sizes_;
   std::unique_ptr<std::byte[]> buffer_;
 };
+
+using TestFreeList = BasicTestFreeList<BlockHeader>;
+
+using CompactTestFreeList = BasicTestFreeList<CompactBlockHeader>;